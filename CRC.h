@@ -0,0 +1,218 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+template<uint8_t Width> struct CRC_Type;
+template<> struct CRC_Type<8U>  { typedef uint8_t  type; };
+template<> struct CRC_Type<16U> { typedef uint16_t type; };
+template<> struct CRC_Type<32U> { typedef uint32_t type; };
+
+/* Index sequence 0..N-1, built with logarithmic instantiation depth. */
+template<size_t... I> struct CRC_Seq {};
+
+template<class A, class B> struct CRC_SeqCat;
+template<size_t... I, size_t... J>
+struct CRC_SeqCat<CRC_Seq<I...>, CRC_Seq<J...> > {
+    typedef CRC_Seq<I..., (sizeof...(I) + J)...> type;
+};
+
+template<size_t N> struct CRC_MakeSeq {
+    typedef typename CRC_SeqCat<
+            typename CRC_MakeSeq<N / 2U>::type,
+            typename CRC_MakeSeq<N - N / 2U>::type>::type type;
+};
+template<> struct CRC_MakeSeq<0U> { typedef CRC_Seq<> type; };
+template<> struct CRC_MakeSeq<1U> { typedef CRC_Seq<0U> type; };
+
+#if defined(__AVR__)
+static inline uint8_t CRC_readTab(const uint8_t* p) { return pgm_read_byte(p); }
+static inline uint16_t CRC_readTab(const uint16_t* p) { return pgm_read_word(p); }
+static inline uint32_t CRC_readTab(const uint32_t* p) { return pgm_read_dword(p); }
+#else
+template<class T> static inline T CRC_readTab(const T* p) { return *p; }
+#endif
+
+#define CRC_TEMPLATE                                                           \
+        uint8_t Width,                                                         \
+        uint32_t Poly,                                                         \
+        uint32_t Init,                                                         \
+        uint32_t XorOut,                                                       \
+        bool Reflect
+
+#define CRC_TEMPLATETYPE                                                       \
+        Width,                                                                 \
+        Poly,                                                                  \
+        Init,                                                                  \
+        XorOut,                                                                \
+        Reflect
+
+template<class T, size_t N> struct CRC_Array { T tab[N]; };
+
+/* Compile-time table and residue generation for CRC. */
+template<uint8_t Width, uint32_t Poly, bool Reflect>
+struct CRC_Gen {
+    typedef typename CRC_Type<Width>::type CRC_t;
+    static const int8_t size = Width / 8U;
+
+    static constexpr CRC_t TOP = (CRC_t)((CRC_t)1U << (Width - 1U));
+
+    static constexpr CRC_t reflect(CRC_t v, uint8_t n, CRC_t r = 0U) {
+        return n == 0U ? r :
+                reflect((CRC_t)(v >> 1U), n - 1U, (CRC_t)((r << 1U) | (v & 1U)));
+    }
+
+    static constexpr CRC_t RPOLY = reflect((CRC_t)Poly, Width);
+
+    static constexpr CRC_t step(CRC_t c, uint8_t n) {
+        return n == 0U ? c : step(
+                Reflect ?
+                    (CRC_t)((c & 1U) ? ((c >> 1U) ^ RPOLY) : (c >> 1U)) :
+                    (CRC_t)((c & TOP) ? ((c << 1U) ^ Poly) : (c << 1U)),
+                n - 1U);
+    }
+
+    /* Byte i followed by k zero bytes, from a zero register. */
+    static constexpr CRC_t entry(size_t k, size_t i) {
+        return k == 0U ?
+                step(Reflect ? (CRC_t)i : (CRC_t)((CRC_t)i << (Width - 8U)), 8U) :
+                shift(entry(k - 1U, i));
+    }
+
+    /* Register after feeding one zero byte. */
+    static constexpr CRC_t shift(CRC_t c) {
+        return Reflect ?
+                (CRC_t)((Width > 8U ? (c >> 8U) : 0U) ^ entry(0U, c & 0xFFU)) :
+                (CRC_t)((Width > 8U ? (c << 8U) : 0U) ^
+                        entry(0U, (c >> (Width - 8U)) & 0xFFU));
+    }
+
+    /* Register after feeding the size bytes of c, in transmission order. */
+    static constexpr CRC_t feed(CRC_t r, CRC_t c, int8_t pos = 0) {
+        return pos == size ? r : feed(
+                Reflect ?
+                    (CRC_t)((Width > 8U ? (r >> 8U) : 0U) ^
+                            entry(0U, (r ^ (c >> (8U * pos))) & 0xFFU)) :
+                    (CRC_t)((Width > 8U ? (r << 8U) : 0U) ^
+                            entry(0U, ((r >> (Width - 8U)) ^
+                                    (c >> (Width - 8U - 8U * pos))) & 0xFFU)),
+                c, pos + 1);
+    }
+
+    template<size_t... I>
+    static constexpr CRC_Array<CRC_t, sizeof...(I)> table(CRC_Seq<I...>) {
+        return CRC_Array<CRC_t, sizeof...(I)>{ { entry(I / 256U, I % 256U)... } };
+    }
+};
+
+/* Table-driven CRC. Poly is given in normal (non-reflected) form. The tables
+ * and the good-frame residue CRC_GOOD are computed at compile time. AVR keeps a
+ * single 256-entry table in PROGMEM; other targets get slice-by-N tables. */
+template<CRC_TEMPLATE>
+struct CRC {
+    typedef typename CRC_Type<Width>::type CRC_t;
+    static const int8_t size        = Width / 8U;
+    static const CRC_t CRC_INIT     = Init;
+    static const CRC_t CRC_FINALXOR = XorOut;
+    static const CRC_t CRC_GOOD     =
+            CRC_Gen<Width, Poly, Reflect>::feed(0U, XorOut);
+
+#if defined(__AVR__)
+    static const uint8_t SLICES = 1U;
+#else
+    static const uint8_t SLICES = (Width >= 32U) ? 8U : 4U;
+#endif
+
+    typedef CRC_Array<CRC_t, SLICES * 256U> Table_t;
+
+    /* CRC_TAB.tab[k * 256U + i]: byte i followed by k zero bytes. */
+#if defined(__AVR__)
+    static constexpr Table_t CRC_TAB PROGMEM =
+#else
+    static constexpr Table_t CRC_TAB =
+#endif
+            CRC_Gen<Width, Poly, Reflect>::table(
+                    typename CRC_MakeSeq<SLICES * 256U>::type());
+
+    void init() { crc = CRC_INIT; }
+    void update(uint8_t data) {
+        if(Reflect)
+            crc = (CRC_t)((Width > 8U ? (crc >> 8U) : 0U) ^
+                    CRC_readTab(&CRC_TAB.tab[(crc ^ data) & 0xFFU]));
+        else
+            crc = (CRC_t)((Width > 8U ? (crc << 8U) : 0U) ^
+                    CRC_readTab(&CRC_TAB.tab[((crc >> (Width - 8U)) ^ data) & 0xFFU]));
+    }
+    void update(const void* vdata, size_t len);
+
+    bool good() { return crc == CRC_GOOD; }
+
+    void final() { crc ^= CRC_FINALXOR; }
+    uint8_t operator[](int8_t pos) {
+        if(Reflect)
+            return crc >> (8U * pos);
+        else
+            return crc >> (Width - 8U - 8U * pos);
+    }
+
+    CRC_t crc;
+};
+
+template<CRC_TEMPLATE>
+constexpr typename CRC<CRC_TEMPLATETYPE>::Table_t CRC<CRC_TEMPLATETYPE>::CRC_TAB;
+
+template<CRC_TEMPLATE>
+void CRC<CRC_TEMPLATETYPE>::update(const void* vdata, size_t len)
+{
+    const uint8_t* data = (const uint8_t*)vdata;
+
+    if(SLICES > 1U)
+    {
+        /* Slice-by-N: fold SLICES bytes per iteration. The register is
+         * combined with the first size bytes, in transmission order. */
+        while(len >= SLICES)
+        {
+            CRC_t x = 0U;
+            for(uint8_t j = 0U; j < SLICES; ++j)
+            {
+                uint8_t c = data[j];
+                if(j < size)
+                    c ^= Reflect ? (crc >> (8U * j)) :
+                            (crc >> (Width - 8U - 8U * j));
+                x ^= CRC_TAB.tab[(SLICES - 1U - j) * 256U + c];
+            }
+            crc = x;
+            data += SLICES;
+            len -= SLICES;
+        }
+    }
+
+    while(len)
+    {
+        update(*data);
+        ++data;
+        --len;
+    }
+}
+
+#endif /* CRC_H_ */
@@ -0,0 +1,80 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "CRC32C.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC32C_SSE42
+#include <string.h>
+#include <nmmintrin.h>
+#endif
+
+#if defined(CRC32C_SSE42)
+
+static bool hasSSE42()
+{
+    static const bool sse42 = __builtin_cpu_supports("sse4.2");
+    return sse42;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t updateSSE42(uint32_t crc, const uint8_t* data, size_t len)
+{
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while(len >= 8U)
+    {
+        uint64_t x;
+        memcpy(&x, data, sizeof(x));
+        crc64 = _mm_crc32_u64(crc64, x);
+        data += 8U;
+        len -= 8U;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while(len >= 4U)
+    {
+        uint32_t x;
+        memcpy(&x, data, sizeof(x));
+        crc = _mm_crc32_u32(crc, x);
+        data += 4U;
+        len -= 4U;
+    }
+    while(len)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+        ++data;
+        --len;
+    }
+    return crc;
+}
+
+#endif
+
+void CRC32C::update(const void* vdata, size_t len)
+{
+    const uint8_t* data = (const uint8_t*)vdata;
+
+#if defined(CRC32C_SSE42)
+    if(hasSSE42())
+    {
+        crc = updateSSE42(crc, data, len);
+        return;
+    }
+#endif
+
+    CRC32C_TABLE::update(data, len);
+}
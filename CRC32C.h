@@ -0,0 +1,30 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef CRC32C_H_
+#define CRC32C_H_
+
+#include "CRC.h"
+
+typedef CRC<32U, 0x1EDC6F41UL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, true> CRC32C_TABLE;
+
+/* CRC-32C (Castagnoli). Uses the SSE4.2 crc32 instruction when available. */
+struct CRC32C: public CRC32C_TABLE {
+    using CRC32C_TABLE::update;
+    void update(const void* vdata, size_t len);
+};
+
+#endif /* CRC32C_H_ */
@@ -0,0 +1,130 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "CRC_CLMUL.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC_CLMUL_X86
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#if defined(CRC_CLMUL_X86)
+
+/* Folding constants for reflected CRCs. Each pair holds the bit-reversed
+ * (x^(n+63) mod P, x^(n-1) mod P) for a folding distance of n bits, used for
+ * the low and high quadwords of the accumulator. */
+static const uint64_t CRC16_FOLD128[2U] = {
+        0xA95D000000000000ULL, 0x7EEA000000000000ULL };
+static const uint64_t CRC16_FOLD512[2U] = {
+        0x9822000000000000ULL, 0x7F90000000000000ULL };
+static const uint64_t CRC32_FOLD128[2U] = {
+        0x65673B4600000000ULL, 0x9BA54C6F00000000ULL };
+static const uint64_t CRC32_FOLD512[2U] = {
+        0x653D982200000000ULL, 0xCAD38E8F00000000ULL };
+
+static bool hasCLMUL()
+{
+    static const bool clmul =
+            __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+    return clmul;
+}
+
+__attribute__((target("pclmul,sse2")))
+static __m128i fold(__m128i x, __m128i k, __m128i next)
+{
+    const __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+    const __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
+
+/* Fold len bytes (a multiple of 64, at least 64) into 16 bytes whose CRC,
+ * computed from a zero register, equals the CRC of the input computed from
+ * the register value crc. */
+__attribute__((target("pclmul,sse2")))
+static void foldBlocks(uint32_t crc, const uint8_t* data, size_t len,
+        const uint64_t (&k128)[2U], const uint64_t (&k512)[2U],
+        uint8_t (&out)[16U])
+{
+    const __m128i* p = (const __m128i*)data;
+    const __m128i c128 = _mm_loadu_si128((const __m128i*)k128);
+    const __m128i c512 = _mm_loadu_si128((const __m128i*)k512);
+
+    __m128i x0 = _mm_xor_si128(_mm_loadu_si128(&p[0U]),
+            _mm_cvtsi32_si128(crc));
+    __m128i x1 = _mm_loadu_si128(&p[1U]);
+    __m128i x2 = _mm_loadu_si128(&p[2U]);
+    __m128i x3 = _mm_loadu_si128(&p[3U]);
+    p += 4U;
+    len -= 64U;
+
+    while(len >= 64U)
+    {
+        x0 = fold(x0, c512, _mm_loadu_si128(&p[0U]));
+        x1 = fold(x1, c512, _mm_loadu_si128(&p[1U]));
+        x2 = fold(x2, c512, _mm_loadu_si128(&p[2U]));
+        x3 = fold(x3, c512, _mm_loadu_si128(&p[3U]));
+        p += 4U;
+        len -= 64U;
+    }
+
+    x1 = fold(x0, c128, x1);
+    x2 = fold(x1, c128, x2);
+    x3 = fold(x2, c128, x3);
+    _mm_storeu_si128((__m128i*)out, x3);
+}
+
+#endif
+
+void CRC16_CCITT_CLMUL::update(const void* vdata, size_t len)
+{
+    const uint8_t* data = (const uint8_t*)vdata;
+
+#if defined(CRC_CLMUL_X86)
+    if(len >= 64U && hasCLMUL())
+    {
+        const size_t num = len & ~(size_t)63U;
+        uint8_t folded[16U];
+        foldBlocks(crc, data, num, CRC16_FOLD128, CRC16_FOLD512, folded);
+        crc = 0U;
+        CRC16_CCITT::update(folded, sizeof(folded));
+        data += num;
+        len -= num;
+    }
+#endif
+
+    CRC16_CCITT::update(data, len);
+}
+
+void CRC32_CLMUL::update(const void* vdata, size_t len)
+{
+    const uint8_t* data = (const uint8_t*)vdata;
+
+#if defined(CRC_CLMUL_X86)
+    if(len >= 64U && hasCLMUL())
+    {
+        const size_t num = len & ~(size_t)63U;
+        uint8_t folded[16U];
+        foldBlocks(crc, data, num, CRC32_FOLD128, CRC32_FOLD512, folded);
+        crc = 0U;
+        CRC32::update(folded, sizeof(folded));
+        data += num;
+        len -= num;
+    }
+#endif
+
+    CRC32::update(data, len);
+}
@@ -0,0 +1,37 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef CRC_CLMUL_H_
+#define CRC_CLMUL_H_
+
+#include "CRC16_CCITT.h"
+#include "CRC32.h"
+
+/* Same checksums as CRC16_CCITT and CRC32. Blocks of 64 bytes or more are
+ * folded with PCLMULQDQ on x86 when the CPU supports it; other targets and
+ * CPUs use the table-driven block update. */
+
+struct CRC16_CCITT_CLMUL: public CRC16_CCITT {
+    using CRC16_CCITT::update;
+    void update(const void* vdata, size_t len);
+};
+
+struct CRC32_CLMUL: public CRC32 {
+    using CRC32::update;
+    void update(const void* vdata, size_t len);
+};
+
+#endif /* CRC_CLMUL_H_ */
@@ -17,111 +17,533 @@
 #ifndef HDLC_H_
 #define HDLC_H_
 
+#include "HDLC_SCAN.h"
+#include "HDLC_STATS.h"
+#include "HDLC_TRACE.h"
+
 #include <stdint.h>
 #include <string.h>
 
-#define HDLC_TEMPLATE                                                          \
-        int16_t (&readByte)(void),                                             \
-        void (&writeByte)(uint8_t data),                                       \
+/* Default block write: one writeByte() call per byte. */
+template<void (&writeByte)(uint8_t data)>
+void HDLC_writeBlock(const uint8_t* data, uint16_t len)
+{
+    while(len)
+    {
+        writeByte(*data);
+        ++data;
+        --len;
+    }
+}
+
+/* I/O through functions bound at compile time. Each set of functions gets its
+ * own instantiation of the HDLC code. */
+template<
+        int16_t (&readByte)(void),
+        void (&writeByte)(uint8_t data),
+        void (&writeBlock)(const uint8_t* data, uint16_t len)>
+struct HDLC_IO_FUNC {
+    static int16_t read() { return readByte(); }
+    static void write(uint8_t data) { writeByte(data); }
+    static void write(const uint8_t* data, uint16_t len) { writeBlock(data, len); }
+};
+
+/* I/O bound at run time through a context pointer. All links with the same
+ * buffer length and CRC share a single instantiation of the HDLC code.
+ * writeBlock is optional; without it blocks are written with writeByte. */
+struct HDLC_IO_PORT {
+    typedef int16_t (*ReadByte_t)(void* ctx);
+    typedef void (*WriteByte_t)(void* ctx, uint8_t data);
+    typedef void (*WriteBlock_t)(void* ctx, const uint8_t* data, uint16_t len);
+
+    HDLC_IO_PORT(void* ctx, ReadByte_t readByte, WriteByte_t writeByte,
+            WriteBlock_t writeBlock = 0):
+        ctx(ctx), readByte(readByte), writeByte(writeByte),
+        writeBlock(writeBlock)
+    {}
+
+    int16_t read() { return readByte(ctx); }
+    void write(uint8_t data) { writeByte(ctx, data); }
+    void write(const uint8_t* data, uint16_t len) {
+        if(writeBlock != 0)
+        {
+            writeBlock(ctx, data, len);
+            return;
+        }
+        while(len)
+        {
+            writeByte(ctx, *data);
+            ++data;
+            --len;
+        }
+    }
+
+    void* ctx;
+    ReadByte_t readByte;
+    WriteByte_t writeByte;
+    WriteBlock_t writeBlock;
+};
+
+/* One buffer of a frame sent from several buffers (scatter-gather). */
+struct HDLC_SEGMENT {
+    const void* data;
+    uint16_t len;
+};
+
+/* Longest encoding of a frame with len bytes: two flags and every byte,
+ * CRC included, escaped. */
+template<class CRC>
+constexpr uint32_t HDLC_encodedSizeMax(uint32_t len)
+{
+    return 2U * (len + (uint32_t)CRC::size) + 2U;
+}
+
+/* Escape len bytes into out at pos. Returns false if out is too small. */
+static inline bool HDLC_encodeBytes(const uint8_t* data, uint16_t len,
+        uint8_t* out, uint32_t size, uint32_t& pos, const uint8_t* map)
+{
+    while(len)
+    {
+        const uint16_t run = HDLC_scan(data, len, map);
+
+        if(run > size - pos)
+            return false;
+        memcpy(&out[pos], data, run);
+        pos += run;
+        data += run;
+        len -= run;
+
+        if(len != 0U)
+        {
+            if(size - pos < 2U)
+                return false;
+            out[pos++] = '}';
+            out[pos++] = *data ^ 0x20U;
+            ++data;
+            --len;
+        }
+    }
+    return true;
+}
+
+/* Encode a whole frame from count segments into out: opening flag, escaped
+ * bytes and CRC, closing flag. The frame can then be written at once, given
+ * to a DMA or sent on several links. Returns the encoded length, or 0 if out
+ * is too small; HDLC_encodedSizeMax<CRC>() of the total length always
+ * suffices. The bytes in map are escaped, see HDLC_SCAN.h. */
+template<class CRC>
+uint32_t HDLC_encodeGather(const HDLC_SEGMENT* seg, uint16_t count,
+        uint8_t* out, uint32_t size,
+        const uint8_t* map = HDLC_ESCAPEMAP_DEFAULT)
+{
+    uint32_t pos = 0U;
+
+    if(size < 2U)
+        return 0U;
+    out[pos++] = '~';
+
+    CRC crc;
+    crc.init();
+    for(uint16_t i = 0U; i < count; ++i)
+    {
+        crc.update(seg[i].data, seg[i].len);
+        if(!HDLC_encodeBytes((const uint8_t*)seg[i].data, seg[i].len,
+                out, size, pos, map))
+            return 0U;
+    }
+    crc.final();
+
+    uint8_t tail[CRC::size];
+    for(int8_t i = 0; i < crc.size; ++i)
+        tail[i] = crc[i];
+
+    if(!HDLC_encodeBytes(tail, crc.size, out, size, pos, map) || pos == size)
+        return 0U;
+
+    out[pos++] = '~';
+    return pos;
+}
+
+/* Encode a frame of head then data; head may be empty. */
+template<class CRC>
+uint32_t HDLC_encode(const void* vhead, uint16_t headLen,
+        const void* vdata, uint16_t len, uint8_t* out, uint32_t size,
+        const uint8_t* map = HDLC_ESCAPEMAP_DEFAULT)
+{
+    const HDLC_SEGMENT seg[2U] = { { vhead, headLen }, { vdata, len } };
+    return HDLC_encodeGather<CRC>(seg, 2U, out, size, map);
+}
+
+template<class CRC>
+uint32_t HDLC_encode(const void* vdata, uint16_t len, uint8_t* out,
+        uint32_t size, const uint8_t* map = HDLC_ESCAPEMAP_DEFAULT)
+{
+    const HDLC_SEGMENT seg = { vdata, len };
+    return HDLC_encodeGather<CRC>(&seg, 1U, out, size, map);
+}
+
+/* Deframer policies for HDLC_CORE. HDLC_DEFRAME_BRANCH tests the state and
+ * the byte with a chain of branches and needs no table. HDLC_DEFRAME_TABLE
+ * looks the action up in a state x byte class table; a data byte is then one
+ * store and one CRC update. Both only matter for the byte at a time
+ * receive(); the block receive() handles runs of data bytes itself.
+ *
+ * The branches are the default: they are the smaller code on AVR and, in
+ * hdlc_bench on x86-64, as fast as the table for plain data and faster for
+ * escaped data. */
+struct HDLC_DEFRAME_BRANCH { static const bool TABLE = false; };
+struct HDLC_DEFRAME_TABLE { static const bool TABLE = true; };
+
+typedef HDLC_DEFRAME_BRANCH HDLC_DEFRAME_DEFAULT;
+
+#define HDLC_CORE_TEMPLATE                                                     \
+        class IO,                                                              \
         uint16_t rxBuffLen,                                                    \
-        class CRC
+        class CRC,                                                             \
+        uint8_t rxFrames,                                                      \
+        class Deframer
 
-#define HDLC_TEMPLATETYPE                                                      \
-        readByte,                                                              \
-        writeByte,                                                             \
+#define HDLC_CORE_TEMPLATETYPE                                                 \
+        IO,                                                                    \
         rxBuffLen,                                                             \
-        CRC
+        CRC,                                                                   \
+        rxFrames,                                                              \
+        Deframer
 
-template<HDLC_TEMPLATE>
-class HDLC
+#define HDLC_TEMPLATEDEFAULT                                                   \
+        int16_t (&readByte)(void),                                             \
+        void (&writeByte)(uint8_t data),                                       \
+        uint16_t rxBuffLen,                                                    \
+        class CRC,                                                             \
+        void (&writeBlock)(const uint8_t* data, uint16_t len) =                \
+                HDLC_writeBlock<writeByte>,                                    \
+        uint8_t rxFrames = 1U,                                                 \
+        class Deframer = HDLC_DEFRAME_DEFAULT
+
+template<HDLC_CORE_TEMPLATE>
+class HDLC_CORE:
+        private IO
 {
 private:
     static const uint8_t DATAINVBIT;
     static const uint8_t DATASTART;
     static const uint8_t DATAESCAPE;
-    static const uint8_t DATAESCAPELIST[];
+
+    /* Actions of the table deframer. */
+    enum {
+        DF_DATA = 0,
+        DF_UNESCAPE,
+        DF_NONE,
+        DF_ESCAPE,
+        DF_DISCARD,
+        DF_FLAG,
+        DF_RESTART
+    };
+    static const uint8_t DEFRAME[8U][4U];
 
 public:
     static const uint16_t RXBFLEN = rxBuffLen;
 
-    HDLC();
+    HDLC_CORE(const IO& io = IO());
     void init();
 
     void transmitBlock(const void* vdata, uint16_t len);
+    void transmitGather(const HDLC_SEGMENT* seg, uint16_t count);
 
     void transmitStart();
     void transmitByte(uint8_t data);
     void transmitBytes(const void* vdata, uint16_t len);
     void transmitEnd();
+    void transmitAbort();
+
+    static constexpr uint32_t encodedSizeMax(uint16_t len) {
+        return HDLC_encodedSizeMax<CRC>(len);
+    }
+    uint32_t encode(const void* vdata, uint16_t len, uint8_t* out,
+            uint32_t size) const {
+        return HDLC_encode<CRC>(vdata, len, out, size, escapeMap);
+    }
+
+    /* Bytes escaped on transmission and dropped on reception unless escaped
+     * (RFC 1662 ACCM), built with HDLC_escapeMapInit(). The map is used in
+     * place and must contain '~' and '}' but not 0x5E; 0 restores the
+     * default. */
+    void setEscapeMap(const uint8_t* map) {
+        escapeMap = (map != 0) ? map : HDLC_ESCAPEMAP_DEFAULT;
+    }
+    const uint8_t* getEscapeMap() const { return escapeMap; }
 
     uint16_t receive();
+    uint16_t receive(const void* vdata, uint16_t size, uint16_t& used);
 
     uint16_t copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const;
     uint16_t copyReceivedMessage(uint8_t *buff, uint16_t pos, uint16_t num) const;
 
+    uint16_t getReceivedMessage(const uint8_t*& msg) const;
+    void holdReceivedMessage();
+    void releaseReceivedMessage();
+
+    uint8_t getReceivedMessageCount() const { return rxCount; }
+    uint16_t getRxOverflowCount() const { return rxOverflow; }
+    uint16_t getRxFilteredCount() const { return rxFiltered; }
+    uint16_t getRxOversizeCount() const { return rxOversize; }
+
+    void getStats(HDLC_LINK_STATS& snapshot) const;
+    void resetStats();
+
+protected:
+    /* The frame closed by the last receive() call had a bad CRC. */
+    bool receiveCrcError() const { return status == CRCERR; }
+
+    /* The frame closed by the last receive() call did not fit the buffer. */
+    bool receiveOversize() const { return status == OVERSIZE; }
+
+    /* Called once the first headLen bytes of a frame are received. If it
+     * returns false the rest of the frame is not stored and the frame is
+     * dropped and counted in getRxFilteredCount(). Without checkCrc the
+     * frame is skipped up to the next flag, unchecked. The filter gets the
+     * core it runs in, which a derived class casts back to itself, so links
+     * stay copyable. */
+    typedef bool (*RxFilter_t)(const HDLC_CORE* core, const uint8_t* head);
+    void setReceiveFilter(RxFilter_t filter, uint8_t headLen, bool checkCrc);
+
 private:
-    static void escapeAndWriteByte(uint8_t data) {
-        const uint8_t n = sizeof(DATAESCAPELIST)/sizeof(DATAESCAPELIST[0]);
-        for(int8_t i = 0; i < n; ++i)
+    void restart();
+    uint16_t receiveByte(uint8_t c);
+    uint16_t receiveByteTable(uint8_t c);
+    uint16_t receiveFlag();
+    void receiveStore(uint8_t c);
+    void receiveFilter();
+
+    uint8_t slot() const { return (rxFrames > 1U) ? rxWrite : 0U; }
+
+    bool escapeNeeded(uint8_t data) const {
+        return HDLC_escapeMapTest(escapeMap, data);
+    }
+
+    /* Unescaped byte in the escape map other than a flag or escape:
+     * inserted by the line, dropped. After an escape it is data. */
+    bool receiveDropped(uint8_t c) const {
+        return status != ESCAPED && escapeNeeded(c) && c != DATASTART &&
+                c != DATAESCAPE;
+    }
+
+    void escapeAndWriteByte(uint8_t data) {
+        if(escapeNeeded(data))
         {
-            if(data == DATAESCAPELIST[i])
-            {
-                writeByte(DATAESCAPE);
-                data ^= DATAINVBIT;
-                break;
-            }
+            IO::write(DATAESCAPE);
+            data ^= DATAINVBIT;
+            statsTxEscape();
         }
-        writeByte(data);
+        IO::write(data);
     }
 
+    void escapeAndWriteBytes(const uint8_t* data, uint16_t len);
+
+    void statsTxData(uint16_t len);
+    void statsTxEscape();
+    void statsTxEnd();
+
     enum {
+        OVERRUN   = -4,
+        SKIP      = -3,
+        DISCARD   = -2,
         ESCAPED   = -1,
         RECEIVING = 0,
         OK        = 1,
-        CRCERR    = 2
+        CRCERR    = 2,
+        OVERSIZE  = 3
     };
 
+    /* Longest frame that fits: the buffer plus the CRC. */
+    static const uint32_t RXFRAMELEN = (uint32_t)rxBuffLen + CRC::size;
+
     CRC txcrc;
+    const uint8_t* escapeMap;
 
     int8_t status;
+    bool held;
     uint16_t len;
+    uint16_t storeLen;
     CRC crc;
-    uint8_t data[RXBFLEN];
+
+    RxFilter_t rxFilter;
+    uint8_t rxFilterLen;
+    bool rxFilterCrc;
+    uint16_t rxFiltered;
+    uint16_t rxOversize;
+
+#if HDLC_STATS
+    /* Bytes and escapes of the frame being transmitted. */
+    uint16_t statsTxLen;
+    uint16_t statsTxEscaped;
+
+protected:
+    HDLC_LINK_STATS stats;
+#endif
+
+    /* Receive queue: rxCount good frames starting at slot rxHead. The frame
+     * being received goes to slot rxWrite. */
+    uint8_t rxHead;
+    uint8_t rxWrite;
+    uint8_t rxCount;
+    uint16_t rxOverflow;
+    uint16_t rxLen[rxFrames];
+    uint8_t data[rxFrames][RXBFLEN];
 };
 
 
 
-template<HDLC_TEMPLATE>
-const uint8_t HDLC<HDLC_TEMPLATETYPE>::DATAINVBIT = 0x20U;
+template<HDLC_CORE_TEMPLATE>
+const uint8_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::DATAINVBIT = 0x20U;
 
-template<HDLC_TEMPLATE>
-const uint8_t HDLC<HDLC_TEMPLATETYPE>::DATASTART  = '~';
+template<HDLC_CORE_TEMPLATE>
+const uint8_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::DATASTART  = '~';
 
-template<HDLC_TEMPLATE>
-const uint8_t HDLC<HDLC_TEMPLATETYPE>::DATAESCAPE = '}';
+template<HDLC_CORE_TEMPLATE>
+const uint8_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::DATAESCAPE = '}';
 
-template<HDLC_TEMPLATE>
-const uint8_t HDLC<HDLC_TEMPLATETYPE>::DATAESCAPELIST[] =
-        { DATASTART, DATAESCAPE };
+/* Action by state (status - OVERRUN) and byte class: data, flag, escape,
+ * other byte of the escape map (dropped unless escaped). */
+template<HDLC_CORE_TEMPLATE>
+const uint8_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::DEFRAME[8U][4U] = {
+    /* OVERRUN   */ { DF_NONE,     DF_FLAG,    DF_NONE,     DF_NONE },
+    /* SKIP      */ { DF_NONE,     DF_FLAG,    DF_NONE,     DF_NONE },
+    /* DISCARD   */ { DF_DISCARD,  DF_FLAG,    DF_DISCARD,  DF_NONE },
+    /* ESCAPED   */ { DF_UNESCAPE, DF_FLAG,    DF_UNESCAPE, DF_UNESCAPE },
+    /* RECEIVING */ { DF_DATA,     DF_FLAG,    DF_ESCAPE,   DF_NONE },
+    /* OK        */ { DF_RESTART,  DF_RESTART, DF_RESTART,  DF_NONE },
+    /* CRCERR    */ { DF_RESTART,  DF_RESTART, DF_RESTART,  DF_NONE },
+    /* OVERSIZE  */ { DF_RESTART,  DF_RESTART, DF_RESTART,  DF_NONE }
+};
 
 
 
-template<HDLC_TEMPLATE>
-HDLC<HDLC_TEMPLATETYPE>::HDLC()
+template<HDLC_CORE_TEMPLATE>
+HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::HDLC_CORE(const IO& io):
+        IO(io)
 {
+    rxOverflow = 0U;
+    rxFiltered = 0U;
+    rxOversize = 0U;
+    escapeMap = HDLC_ESCAPEMAP_DEFAULT;
+    resetStats();
+    setReceiveFilter(0, 0U, false);
     init();
 }
 
-template<HDLC_TEMPLATE>
-void HDLC<HDLC_TEMPLATETYPE>::init()
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::init()
+{
+    rxHead = 0U;
+    rxWrite = 0U;
+    rxCount = 0U;
+    held = false;
+    restart();
+}
+
+/* Start receiving a new frame. With a single slot the last frame is dropped
+ * unless it is held; with more slots the frame goes to the next free slot, or
+ * is discarded and counted if the queue is full. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::restart()
 {
+    if(rxFrames == 1U && !held)
+        rxCount = 0U;
+
     len = 0U;
-    status = RECEIVING;
+    storeLen = RXBFLEN;
     crc.init();
+
+    if(rxCount < rxFrames)
+    {
+        rxWrite = (rxHead + rxCount) % rxFrames;
+        status = RECEIVING;
+    }
+    else
+    {
+        status = DISCARD;
+    }
+}
+
+/* headLen must not exceed the receive buffer length. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
+        setReceiveFilter(RxFilter_t filter, uint8_t headLen, bool checkCrc)
+{
+    rxFilter = filter;
+    rxFilterLen = (filter != 0) ? headLen : 0U;
+    rxFilterCrc = checkCrc;
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::receiveFilter()
+{
+    if(rxFilter(this, data[slot()]))
+        return;
+
+    if(rxFilterCrc)
+        storeLen = 0U;
+    else
+        status = SKIP;
 }
 
-template<HDLC_TEMPLATE>
-void HDLC<HDLC_TEMPLATETYPE>::
+/* Snapshot of the statistics; all zero without HDLC_STATS. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::getStats(HDLC_LINK_STATS& snapshot) const
+{
+#if HDLC_STATS
+    HDLC_statsCopy(snapshot, stats);
+#else
+    memset(&snapshot, 0, sizeof(snapshot));
+#endif
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::resetStats()
+{
+#if HDLC_STATS
+    HDLC_statsClear(stats);
+    statsTxLen = 0U;
+    statsTxEscaped = 0U;
+#endif
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::statsTxData(uint16_t len)
+{
+#if HDLC_STATS
+    HDLC_STATS_ADD(txBytes, len);
+    statsTxLen += len;
+#else
+    (void)len;
+#endif
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::statsTxEscape()
+{
+#if HDLC_STATS
+    HDLC_STATS_ADD(txEscaped, 1U);
+    ++statsTxEscaped;
+#endif
+}
+
+/* The ratio counts the CRC too, as its bytes may be escaped. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::statsTxEnd()
+{
+#if HDLC_STATS
+    HDLC_STATS_ADD(txFrames, 1U);
+    HDLC_STATS_ADD(txEscape[HDLC_statsEscapeBin(statsTxEscaped,
+            statsTxLen + txcrc.size)], 1U);
+    statsTxLen = 0U;
+    statsTxEscaped = 0U;
+#endif
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
         transmitBlock(const void* vdata, uint16_t len)
 {
     transmitStart();
@@ -129,119 +551,399 @@ void HDLC<HDLC_TEMPLATETYPE>::
     transmitEnd();
 }
 
-template<HDLC_TEMPLATE>
-void HDLC<HDLC_TEMPLATETYPE>::transmitStart()
+/* One frame from several buffers, without copying them together. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
+        transmitGather(const HDLC_SEGMENT* seg, uint16_t count)
 {
-    writeByte(DATASTART);
+    transmitStart();
+    for(uint16_t i = 0U; i < count; ++i)
+        transmitBytes(seg[i].data, seg[i].len);
+    transmitEnd();
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::transmitStart()
+{
+    IO::write(DATASTART);
     txcrc.init();
+    HDLC_TRACE_EVENT(HDLC_TRACE_TX_START, 0U);
 }
 
-template<HDLC_TEMPLATE>
-void HDLC<HDLC_TEMPLATETYPE>::transmitByte(uint8_t data)
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::transmitByte(uint8_t data)
 {
     escapeAndWriteByte(data);
     txcrc.update(data);
+    statsTxData(1U);
 }
 
-template<HDLC_TEMPLATE>
-void HDLC<HDLC_TEMPLATETYPE>::
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
         transmitBytes(const void* vdata, uint16_t len)
 {
     const uint8_t* data = (const uint8_t*)vdata;
-    while(len)
-    {
-        transmitByte(*data);
-        ++data;
-        --len;
-    }
+    txcrc.update(data, len);
+    escapeAndWriteBytes(data, len);
+    statsTxData(len);
 }
 
-template<HDLC_TEMPLATE>
-void HDLC<HDLC_TEMPLATETYPE>::transmitEnd()
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::transmitEnd()
 {
     txcrc.final();
     for(int8_t i = 0; i < txcrc.size; ++i)
         escapeAndWriteByte(txcrc[i]);
-    writeByte(DATASTART);
+    IO::write(DATASTART);
+    statsTxEnd();
+    HDLC_TRACE_EVENT(HDLC_TRACE_TX_END, 0U);
+}
+
+/* End the frame with the RFC 1662 abort sequence "}~" instead of the CRC. The
+ * receiver drops it. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::transmitAbort()
+{
+    IO::write(DATAESCAPE);
+    IO::write(DATASTART);
+#if HDLC_STATS
+    statsTxLen = 0U;
+    statsTxEscaped = 0U;
+#endif
+    HDLC_TRACE_EVENT(HDLC_TRACE_TX_END, 0U);
 }
 
-template<HDLC_TEMPLATE>
-uint16_t HDLC<HDLC_TEMPLATETYPE>::receive()
+/* Write runs of bytes that need no escaping with a single block write.
+ * Only the bytes that must be escaped are written one at a time. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
+        escapeAndWriteBytes(const uint8_t* data, uint16_t len)
 {
-    int16_t c = readByte();
+    while(len)
+    {
+        const uint16_t run = HDLC_scan(data, len, escapeMap);
+
+        if(run != 0U)
+        {
+            IO::write(data, run);
+            data += run;
+            len -= run;
+        }
+
+        if(len != 0U)
+        {
+            IO::write(DATAESCAPE);
+            IO::write(*data ^ DATAINVBIT);
+            statsTxEscape();
+            ++data;
+            --len;
+        }
+    }
+}
+
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::receive()
+{
+    if(held)
+        return 0U;
+
+    int16_t c = IO::read();
     if(c == -1)
         return 0U;
 
-    if(status >= OK)
-        init();
+    return receiveByte(c);
+}
 
+/* Deframe a block of received bytes. Stops right after a frame is closed (good
+ * or bad) so the frame can be read before the next byte overwrites it. The
+ * number of bytes consumed is returned in used; call again with the remaining
+ * bytes until the whole block has been used. Nothing is consumed while a
+ * received message is held. */
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
+        receive(const void* vdata, uint16_t size, uint16_t& used)
+{
+    const uint8_t* buff = (const uint8_t*)vdata;
     uint16_t retv = 0U;
+    used = 0U;
+    if(held)
+        return 0U;
 
-    if(c == DATASTART)
+    while(used < size)
     {
-        if(status == RECEIVING && len != 0U)
+        if(status == RECEIVING)
         {
-            if(crc.good())
+            /* Copy a run of plain data bytes and update the CRC over it at
+             * once. Flags and escapes go through receiveByte(). A run stops
+             * at the end of the header for the receive filter. */
+            uint16_t end = size;
+            if(len < rxFilterLen && size - used > rxFilterLen - len)
+                end = used + (rxFilterLen - len);
+
+            const uint16_t run = HDLC_scan(&buff[used], end - used, escapeMap);
+
+            if((uint32_t)len + run > RXFRAMELEN)
             {
-                status = OK;
-                len -= crc.size;
-                retv = len;
+                /* Too long: no more CRC or copy, just find the end. */
+                status = OVERRUN;
+                used += run;
+                if(used == size)
+                    break;
             }
-            else
+            else if(run != 0U)
             {
-                status = CRCERR;
+#if HDLC_TRACE
+                if(len == 0U)
+                    HDLC_TRACE_EVENT(HDLC_TRACE_RX_START, 0U);
+#endif
+                crc.update(&buff[used], run);
+                if(len < storeLen)
+                {
+                    const uint16_t num = (run > storeLen - len) ?
+                            (storeLen - len) : run;
+                    memcpy(&data[slot()][len], &buff[used], num);
+                }
+                const uint16_t start = len;
+                len += run;
+                used += run;
+                if(start < rxFilterLen && len >= rxFilterLen)
+                    receiveFilter();
+                if(used == size)
+                    break;
             }
         }
-        else
+
+        if(status == SKIP || status == OVERRUN)
         {
-            init();
+            /* Filtered or too long frame: jump to the next flag. */
+            const uint8_t* flag = (const uint8_t*)
+                    memchr(&buff[used], DATASTART, size - used);
+            if(flag == 0)
+            {
+                used = size;
+                break;
+            }
+            used = flag - buff;
         }
+
+        retv = receiveByte(buff[used]);
+        ++used;
+        if(status >= OK)
+            break;
     }
-    else
+    return retv;
+}
+
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::receiveByte(uint8_t c)
+{
+    if(Deframer::TABLE)
+        return receiveByteTable(c);
+
+    if(receiveDropped(c))
+        return 0U;
+
+    if(status >= OK)
+        restart();
+
+    if(c == DATASTART)
+        return receiveFlag();
+
+    if(status == DISCARD)
+    {
+        /* Queue full. Count the frame once, on its first byte. */
+        if(len == 0U)
+        {
+            ++rxOverflow;
+            len = 1U;
+        }
+    }
+    else if(status == SKIP || status == OVERRUN)
+    {
+        /* Filtered or too long frame. */
+    }
+    else if(status == ESCAPED || c != DATAESCAPE)
     {
         if(status == ESCAPED)
         {
             status = RECEIVING;
-
             c ^= DATAINVBIT;
-            crc.update(c);
-            if(len < RXBFLEN)
-                data[len] = c;
-            ++len;
         }
-        else if(c != DATAESCAPE)
+        receiveStore(c);
+    }
+    else
+    {
+        status = ESCAPED;
+        HDLC_STATS_ADD(rxEscaped, 1U);
+    }
+
+    return 0U;
+}
+
+/* Same as receiveByte(), one table lookup instead of the branches. A data
+ * byte, escaped or not, that is not the first of the frame, fits the buffer
+ * and does not complete the header for the receive filter is stored at once.
+ * DF_DATA and DF_UNESCAPE are 0 and 1 so the action selects the XOR. */
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::receiveByteTable(uint8_t c)
+{
+    /* 0 data, 1 flag, 2 escape, 3 other byte of the map. */
+    const uint8_t type = (uint8_t)(escapeNeeded(c) *
+            (3U - 2U * (c == DATASTART) - (c == DATAESCAPE)));
+    const uint8_t action = DEFRAME[status - OVERRUN][type];
+
+    if(action <= DF_UNESCAPE)
+    {
+        c ^= (uint8_t)(action * DATAINVBIT);
+        status = RECEIVING;
+        if(len < storeLen && len + 1U != rxFilterLen
+#if HDLC_TRACE
+                && len != 0U
+#endif
+                )
         {
+            data[slot()][len] = c;
             crc.update(c);
-            if(len < RXBFLEN)
-                data[len] = c;
             ++len;
         }
         else
         {
+            receiveStore(c);
+        }
+        return 0U;
+    }
+
+    switch(action) {
+        case DF_ESCAPE:
             status = ESCAPED;
+            HDLC_STATS_ADD(rxEscaped, 1U);
+            break;
+        case DF_FLAG:
+            return receiveFlag();
+        case DF_RESTART:
+            restart();
+            return receiveByteTable(c);
+        case DF_DISCARD:
+            /* Queue full. Count the frame once, on its first byte. */
+            if(len == 0U)
+            {
+                ++rxOverflow;
+                len = 1U;
+            }
+            break;
+        default:
+            break;
+    }
+    return 0U;
+}
+
+/* Closing or opening flag. Returns the length of a good frame. */
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::receiveFlag()
+{
+    uint16_t retv = 0U;
+
+    if(status == SKIP)
+    {
+        ++rxFiltered;
+        restart();
+    }
+    else if(status == OVERRUN)
+    {
+        ++rxOversize;
+        HDLC_STATS_ADD(rxOversize, 1U);
+        status = OVERSIZE;
+    }
+    else if(status == ESCAPED)
+    {
+        /* "}~" aborts the frame (RFC 1662). */
+        HDLC_STATS_ADD(rxAborted, 1U);
+        restart();
+    }
+    else if(status == RECEIVING && len != 0U)
+    {
+        HDLC_TRACE_EVENT(HDLC_TRACE_RX_END, len);
+        if(storeLen == 0U)
+        {
+            /* Filtered frame. */
+            if(crc.good())
+                ++rxFiltered;
+            restart();
+        }
+        else if(crc.good())
+        {
+            status = OK;
+            len -= crc.size;
+            retv = len;
+            HDLC_STATS_ADD(rxFrames, 1U);
+            HDLC_STATS_ADD(rxBytes, len);
+            HDLC_STATS_ADD(rxSize[HDLC_statsSizeBin(len)], 1U);
+            if(len == 0U)
+                HDLC_STATS_ADD(rxEmpty, 1U);
+            HDLC_TRACE_EVENT(HDLC_TRACE_RX_GOOD, len);
+
+            rxLen[slot()] = len;
+            ++rxCount;
+        }
+        else
+        {
+            status = CRCERR;
+            HDLC_STATS_ADD(rxCrcErrors, 1U);
+            HDLC_TRACE_EVENT(HDLC_TRACE_RX_BAD, len);
         }
     }
+    else
+    {
+        restart();
+    }
 
     return retv;
 }
 
-template<HDLC_TEMPLATE>
-uint16_t HDLC<HDLC_TEMPLATETYPE>::copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const
+/* Data byte, already unescaped. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::receiveStore(uint8_t c)
+{
+#if HDLC_TRACE
+    if(len == 0U)
+        HDLC_TRACE_EVENT(HDLC_TRACE_RX_START, 0U);
+#endif
+    if(len < storeLen)
+    {
+        data[slot()][len] = c;
+    }
+    else if(len == RXFRAMELEN)
+    {
+        status = OVERRUN;
+        return;
+    }
+    crc.update(c);
+    ++len;
+    if(len == rxFilterLen)
+        receiveFilter();
+}
+
+/* Copy of the oldest received frame, the one getReceivedMessage() points
+ * to. Returns 0 if there is no frame. */
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const
 {
-    const uint16_t datalen = (len > RXBFLEN) ? RXBFLEN : len;
-    memcpy(buff, data, datalen);
+    const uint8_t* msg;
+    const uint16_t datalen = getReceivedMessage(msg);
+    memcpy(buff, msg, datalen);
     return datalen;
 }
 
-template<HDLC_TEMPLATE>
-uint16_t HDLC<HDLC_TEMPLATETYPE>::
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
         copyReceivedMessage(uint8_t *buff, uint16_t pos, uint16_t num) const
 {
-    const uint16_t datalen = (len > RXBFLEN) ? RXBFLEN : len;
-    if(pos < RXBFLEN)
+    const uint8_t* msg;
+    const uint16_t datalen = getReceivedMessage(msg);
+    if(pos < datalen)
     {
         num = (pos + num) > datalen ? (datalen - pos) : num;
-        memcpy(buff, &data[pos], num);
+        memcpy(buff, &msg[pos], num);
     }
     else
     {
@@ -250,4 +952,65 @@ uint16_t HDLC<HDLC_TEMPLATETYPE>::
     return num;
 }
 
+/* Zero-copy access to the oldest received frame. With a single slot the
+ * pointer is valid until the next frame starts, or until
+ * releaseReceivedMessage() if the message is held. With more slots every
+ * frame is kept until it is released. Returns 0 if there is no frame. */
+template<HDLC_CORE_TEMPLATE>
+uint16_t HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::
+        getReceivedMessage(const uint8_t*& msg) const
+{
+    msg = data[(rxFrames > 1U) ? rxHead : 0U];
+    if(rxCount == 0U)
+        return 0U;
+    const uint16_t datalen = rxLen[(rxFrames > 1U) ? rxHead : 0U];
+    return (datalen > RXBFLEN) ? RXBFLEN : datalen;
+}
+
+/* Keep the last good frame while it is processed. receive() does not read any
+ * input until releaseReceivedMessage() is called. Only needed with a single
+ * slot. */
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::holdReceivedMessage()
+{
+    held = (rxFrames == 1U && rxCount != 0U);
+}
+
+template<HDLC_CORE_TEMPLATE>
+void HDLC_CORE<HDLC_CORE_TEMPLATETYPE>::releaseReceivedMessage()
+{
+    held = false;
+    if(rxCount != 0U)
+    {
+        rxHead = (rxHead + 1U) % rxFrames;
+        --rxCount;
+
+        /* A frame opened while the queue was full and nothing of it arrived
+         * yet: it gets the free slot. */
+        if(status == DISCARD && len == 0U)
+            restart();
+    }
+}
+
+/* HDLC with I/O functions given as template arguments. */
+template<HDLC_TEMPLATEDEFAULT>
+class HDLC:
+        public HDLC_CORE<
+                HDLC_IO_FUNC<readByte, writeByte, writeBlock>,
+                rxBuffLen, CRC, rxFrames, Deframer>
+{
+};
+
+/* HDLC with I/O bound at run time. */
+template<uint16_t rxBuffLen, class CRC, uint8_t rxFrames = 1U,
+        class Deframer = HDLC_DEFRAME_DEFAULT>
+class HDLC_PORT:
+        public HDLC_CORE<HDLC_IO_PORT, rxBuffLen, CRC, rxFrames, Deframer>
+{
+public:
+    HDLC_PORT(const HDLC_IO_PORT& io):
+        HDLC_CORE<HDLC_IO_PORT, rxBuffLen, CRC, rxFrames, Deframer>(io)
+    {}
+};
+
 #endif /* HDLC_H_ */
@@ -0,0 +1,487 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "HDLC_LINK_MANAGER.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+HDLC_LINK::HDLC_LINK(int fd):
+        fd(fd), manager(0), handler(0), handlerCtx(0), held(false),
+        rxStalled(false), events(0U), txWaiting(false)
+{
+    txBuff.reserve(TXBFLEN);
+}
+
+/* Give back the message kept with hold(). */
+void HDLC_LINK::release()
+{
+    if(!held)
+        return;
+    held = false;
+    releaseReceived();
+}
+
+/* Write the buffered output. The descriptor is non-blocking once the link is
+ * added to a manager: what it does not take now is kept, and the manager
+ * writes it when epoll reports the descriptor writable. Returns false if the
+ * descriptor failed; the output is dropped. */
+bool HDLC_LINK::flush()
+{
+    if(txWaiting)
+        return true;
+
+    size_t done = 0U;
+    while(done < txBuff.size() && fd >= 0)
+    {
+        ssize_t n = ::write(fd, &txBuff[done], txBuff.size() - done);
+        if(n > 0)
+        {
+            done += n;
+        }
+        else if(n < 0 && errno == EAGAIN)
+        {
+            txBuff.erase(txBuff.begin(), txBuff.begin() + done);
+            HDLC_LINK_MANAGER* const owner = manager;
+            if(owner != 0)
+            {
+                txWaiting = true;
+                owner->watch(*this);
+            }
+            return true;
+        }
+        else if(n < 0 && errno == EINTR)
+        {
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    const bool ok = (done == txBuff.size());
+    txBuff.clear();
+    return ok;
+}
+
+int16_t HDLC_LINK::readByte(void* ctx)
+{
+    HDLC_LINK* link = (HDLC_LINK*)ctx;
+    uint8_t c;
+    if(link->fd < 0 || ::read(link->fd, &c, 1U) != 1)
+        return -1;
+    return c;
+}
+
+/* A flag after frame data closes the frame: send it at once. */
+void HDLC_LINK::writeByte(void* ctx, uint8_t data)
+{
+    HDLC_LINK* link = (HDLC_LINK*)ctx;
+    if(link->txBuff.size() >= TXQUEUEMAX)
+        return;
+    link->txBuff.push_back(data);
+    if(link->txBuff.size() >= TXBFLEN || (data == '~' && link->txBuff.size() > 1U))
+        link->flush();
+}
+
+void HDLC_LINK::writeBlock(void* ctx, const uint8_t* data, uint16_t len)
+{
+    HDLC_LINK* link = (HDLC_LINK*)ctx;
+    if(len > TXQUEUEMAX - link->txBuff.size())
+        len = TXQUEUEMAX - link->txBuff.size();
+    link->txBuff.insert(link->txBuff.end(), data, data + len);
+    if(link->txBuff.size() >= TXBFLEN)
+        link->flush();
+}
+
+
+
+static uint64_t monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000U + ts.tv_nsec / 1000000;
+}
+
+
+
+/* The links are polled every 10 ms by default. */
+HDLC_LINK_MANAGER::HDLC_LINK_MANAGER():
+        links(0U), tick(10), nextTick(0U), stopping(false)
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    evfd = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = 0;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev);
+}
+
+HDLC_LINK_MANAGER::~HDLC_LINK_MANAGER()
+{
+    close(evfd);
+    close(epfd);
+}
+
+/* Add a link. Its descriptor is made non-blocking. A link belongs to one
+ * manager at a time. Can be called from any thread: the link is set up
+ * before its descriptor enters the epoll set, and is not touched here after
+ * that. */
+bool HDLC_LINK_MANAGER::add(HDLC_LINK& link)
+{
+    if(link.fd < 0 || link.manager != 0)
+        return false;
+
+    int flags = fcntl(link.fd, F_GETFL);
+    if(flags < 0 || fcntl(link.fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return false;
+
+    link.rxStalled = false;
+    link.rxRest.clear();
+    link.txWaiting = false;
+    link.events = EPOLLIN | EPOLLRDHUP;
+    link.manager = this;
+
+    struct epoll_event ev;
+    ev.events = link.events;
+    ev.data.ptr = &link;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, link.fd, &ev) < 0)
+    {
+        link.events = 0U;
+        link.manager = 0;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        linkList.push_back(&link);
+    }
+    ++links;
+    return true;
+}
+
+/* Remove a link. Call it from the thread running the manager, or while the
+ * manager is not running. */
+void HDLC_LINK_MANAGER::remove(HDLC_LINK& link)
+{
+    if(link.manager != this)
+        return;
+
+    if(link.fd >= 0 && link.events != 0U)
+        epoll_ctl(epfd, EPOLL_CTL_DEL, link.fd, 0);
+    link.events = 0U;
+    link.txWaiting = false;
+
+    if(link.rxStalled)
+    {
+        for(size_t i = 0U; i < stalled.size(); ++i)
+        {
+            if(stalled[i] == &link)
+            {
+                stalled[i] = stalled.back();
+                stalled.pop_back();
+                break;
+            }
+        }
+        link.rxStalled = false;
+        link.rxRest.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(size_t i = 0U; i < linkList.size(); ++i)
+        {
+            if(linkList[i] == &link)
+            {
+                linkList.erase(linkList.begin() + i);
+                break;
+            }
+        }
+    }
+
+    link.manager = 0;
+    --links;
+}
+
+/* Set the epoll events of a link: input unless it is stalled on a held
+ * message, output while it has output waiting. A link waiting for nothing is
+ * taken out of the epoll set, so a hang up does not wake the loop until it is
+ * read again. */
+bool HDLC_LINK_MANAGER::watch(HDLC_LINK& link)
+{
+    struct epoll_event ev;
+    ev.events = (link.rxStalled ? 0U : (EPOLLIN | EPOLLRDHUP)) |
+            (link.txWaiting ? EPOLLOUT : 0U);
+    ev.data.ptr = &link;
+    if(ev.events == link.events)
+        return true;
+
+    const int op = (link.events == 0U) ? EPOLL_CTL_ADD :
+            (ev.events == 0U) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    if(epoll_ctl(epfd, op, link.fd, &ev) < 0)
+        return false;
+    link.events = ev.events;
+    return true;
+}
+
+/* Feed input to a link. If the handler holds a message, keep what was not
+ * used and stop reading the link until it is released. */
+void HDLC_LINK_MANAGER::feed(HDLC_LINK& link, const uint8_t* data, uint16_t size)
+{
+    const uint16_t used = link.input(data, size);
+    if(link.manager == this && link.isHeld())
+    {
+        link.rxRest.assign(data + used, data + size);
+        if(!link.rxStalled)
+        {
+            link.rxStalled = true;
+            stalled.push_back(&link);
+            watch(link);
+        }
+    }
+    link.flush();
+}
+
+/* Run the timers of every link and write what they send. */
+void HDLC_LINK_MANAGER::pollLinks()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(size_t i = 0U; i < linkList.size(); ++i)
+    {
+        linkList[i]->poll();
+        linkList[i]->flush();
+    }
+}
+
+/* Go on with the links whose held message was released. */
+void HDLC_LINK_MANAGER::resume()
+{
+    size_t i = 0U;
+    while(i < stalled.size())
+    {
+        HDLC_LINK* link = stalled[i];
+        if(link->isHeld())
+        {
+            ++i;
+            continue;
+        }
+
+        stalled[i] = stalled.back();
+        stalled.pop_back();
+        link->rxStalled = false;
+
+        std::vector<uint8_t> rest;
+        rest.swap(link->rxRest);
+        feed(*link, rest.data(), rest.size());
+        if(link->manager == this)
+            watch(*link);
+    }
+}
+
+/* Wait up to timeout ms (-1 forever) for ready links, then read each ready
+ * descriptor once and feed its deframer. Level triggered: a link with more
+ * input is served again on the next call, so a busy link cannot starve the
+ * others. The wait ends early for the next tick, which polls every link.
+ * Links whose held message was released are resumed at the end. Returns the
+ * number of links served, or -1 on error. */
+int HDLC_LINK_MANAGER::poll(int timeout)
+{
+    struct epoll_event events[MAXEVENTS];
+
+    const int period = tick;
+    if(period > 0)
+    {
+        const uint64_t now = monotonicMs();
+        const int due = (now >= nextTick) ? 0 : (int)(nextTick - now);
+        if(timeout < 0 || timeout > due)
+            timeout = due;
+    }
+
+    int n = epoll_wait(epfd, events, MAXEVENTS, timeout);
+    if(n < 0)
+        return (errno == EINTR) ? 0 : -1;
+
+    int served = 0;
+    for(int i = 0; i < n; ++i)
+    {
+        HDLC_LINK* link = (HDLC_LINK*)events[i].data.ptr;
+        if(link == 0)
+        {
+            /* Woken up by stop(). */
+            uint64_t value;
+            if(read(evfd, &value, sizeof(value)) < 0)
+            {
+            }
+            continue;
+        }
+
+        /* Removed by a handler earlier in this pass. */
+        if(link->manager != this)
+            continue;
+
+        if(link->txWaiting &&
+                (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0U)
+        {
+            link->txWaiting = false;
+            link->flush();
+            watch(*link);
+        }
+
+        /* Stalled on a held message, or only writable. */
+        if(link->rxStalled || (events[i].events & ~EPOLLOUT) == 0U)
+            continue;
+
+        ssize_t len = read(link->fd, rxBuff, RXBFLEN);
+        if(len > 0)
+        {
+            feed(*link, rxBuff, len);
+            ++served;
+        }
+        else if(len == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            /* End of file, or EIO from a pty whose other side closed. */
+            remove(*link);
+            link->fd = -1;
+        }
+    }
+
+    if(period > 0)
+    {
+        const uint64_t now = monotonicMs();
+        if(now >= nextTick)
+        {
+            nextTick = now + period;
+            pollLinks();
+        }
+    }
+
+    resume();
+    return served;
+}
+
+void HDLC_LINK_MANAGER::run()
+{
+    while(!stopping)
+    {
+        if(poll(-1) < 0)
+            break;
+    }
+    stopping = false;
+}
+
+/* Make run() return. Can be called from any thread, also before run() is
+ * entered. */
+void HDLC_LINK_MANAGER::stop()
+{
+    stopping = true;
+    uint64_t value = 1U;
+    if(write(evfd, &value, sizeof(value)) < 0)
+    {
+    }
+}
+
+
+
+/* Use one shard per hardware thread if shards is 0. */
+HDLC_LINK_SHARDS::HDLC_LINK_SHARDS(unsigned shards):
+        next(0U)
+{
+    if(shards == 0U)
+        shards = std::thread::hardware_concurrency();
+    if(shards == 0U)
+        shards = 1U;
+
+    for(unsigned i = 0U; i < shards; ++i)
+        managers.push_back(new HDLC_LINK_MANAGER());
+}
+
+HDLC_LINK_SHARDS::~HDLC_LINK_SHARDS()
+{
+    stop();
+    for(unsigned i = 0U; i < managers.size(); ++i)
+        delete managers[i];
+}
+
+/* Add a link to the least loaded shard. Can be called while running, from
+ * one thread at a time. */
+bool HDLC_LINK_SHARDS::add(HDLC_LINK& link)
+{
+    unsigned best = next;
+    for(unsigned i = 0U; i < managers.size(); ++i)
+    {
+        if(managers[i]->getLinkCount() < managers[best]->getLinkCount())
+            best = i;
+    }
+    next = (best + 1U) % managers.size();
+    return managers[best]->add(link);
+}
+
+/* Tick of every shard, see HDLC_LINK_MANAGER::setTick(). */
+void HDLC_LINK_SHARDS::setTick(int ms)
+{
+    for(unsigned i = 0U; i < managers.size(); ++i)
+        managers[i]->setTick(ms);
+}
+
+/* Remove a link. Call it from the thread of the link's shard, such as from
+ * its handler, or while the shards are not running. */
+void HDLC_LINK_SHARDS::remove(HDLC_LINK& link)
+{
+    HDLC_LINK_MANAGER* const owner = link.manager;
+    if(owner != 0)
+        owner->remove(link);
+}
+
+/* Start one thread per shard, each pinned to its own CPU. */
+void HDLC_LINK_SHARDS::start()
+{
+    if(!threads.empty())
+        return;
+
+    const unsigned cpus = std::thread::hardware_concurrency();
+    for(unsigned i = 0U; i < managers.size(); ++i)
+    {
+        threads.push_back(std::thread(&HDLC_LINK_MANAGER::run, managers[i]));
+        if(cpus != 0U)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % cpus, &set);
+            pthread_setaffinity_np(threads.back().native_handle(),
+                    sizeof(set), &set);
+        }
+    }
+}
+
+void HDLC_LINK_SHARDS::stop()
+{
+    for(unsigned i = 0U; i < threads.size(); ++i)
+        managers[i]->stop();
+    for(unsigned i = 0U; i < threads.size(); ++i)
+        threads[i].join();
+    threads.clear();
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,309 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef HDLC_LINK_MANAGER_H_
+#define HDLC_LINK_MANAGER_H_
+
+/* Linux event loop running many links attached to file descriptors (ttys,
+ * ptys, pipes, sockets). Not available on other targets. */
+#if defined(__linux__)
+
+#include "HDLC.h"
+#include "HDLC_TL1B.h"
+#include "HDLC_TL3B_TOKEN.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class HDLC_LINK_MANAGER;
+
+/* A link driven by HDLC_LINK_MANAGER. The manager reads the descriptor and
+ * feeds the bytes to input(); every received message is passed to the
+ * handler. Output is buffered and written when a frame is closed or TXBFLEN
+ * bytes are waiting. Writes never block: what the descriptor does not take is
+ * kept and written when it becomes writable. Output beyond TXQUEUEMAX bytes
+ * is dropped.
+ *
+ * A handler can keep its message after it returns with hold(). The link then
+ * reads no input until release(), and goes on from the byte where it stopped.
+ * Call release() on the thread running the manager; the input is resumed at
+ * the end of its current pass. */
+class HDLC_LINK {
+public:
+    typedef void (*Handler_t)(void* ctx, HDLC_LINK& link,
+            const uint8_t* msg, uint16_t len);
+
+    static const uint16_t TXBFLEN = 1024U;
+    static const uint32_t TXQUEUEMAX = 65536U;
+
+    HDLC_LINK(int fd);
+    virtual ~HDLC_LINK() {}
+
+    int getFd() const { return fd; }
+    bool isOpen() const { return fd >= 0; }
+
+    void setHandler(Handler_t handler, void* ctx) {
+        this->handler = handler;
+        this->handlerCtx = ctx;
+    }
+
+    void hold() { held = true; }
+    void release();
+    bool isHeld() const { return held; }
+
+    /* Returns the number of bytes used, less than size if a message is
+     * held. */
+    virtual uint16_t input(const uint8_t* data, uint16_t size) = 0;
+
+    /* Called by the manager every tick, also on a silent line, to run the
+     * protocol timers. */
+    virtual void poll() {}
+
+    bool flush();
+
+protected:
+    HDLC_IO_PORT io() { return HDLC_IO_PORT(this, readByte, writeByte, writeBlock); }
+
+    /* Pass a message to the handler and release it, unless it is held. */
+    void dispatch(const uint8_t* msg, uint16_t len) {
+        if(handler != 0)
+            handler(handlerCtx, *this, msg, len);
+        if(!held)
+            releaseReceived();
+    }
+
+    virtual void releaseReceived() = 0;
+
+private:
+    friend class HDLC_LINK_MANAGER;
+    friend class HDLC_LINK_SHARDS;
+
+    static int16_t readByte(void* ctx);
+    static void writeByte(void* ctx, uint8_t data);
+    static void writeBlock(void* ctx, const uint8_t* data, uint16_t len);
+
+    int fd;
+    /* Set before the link enters the epoll set, read by the manager's
+     * thread. */
+    std::atomic<HDLC_LINK_MANAGER*> manager;
+    Handler_t handler;
+    void* handlerCtx;
+    bool held;
+    bool rxStalled;
+    uint32_t events;
+    std::vector<uint8_t> rxRest;
+    bool txWaiting;
+    std::vector<uint8_t> txBuff;
+};
+
+/* HDLC link on a file descriptor. */
+template<uint16_t rxBuffLen, class CRC, uint8_t rxFrames = 1U>
+class HDLC_FD:
+        public HDLC_LINK,
+        public HDLC_PORT<rxBuffLen, CRC, rxFrames>
+{
+public:
+    HDLC_FD(int fd):
+        HDLC_LINK(fd),
+        HDLC_PORT<rxBuffLen, CRC, rxFrames>(io())
+    {}
+
+    /* Messages still queued after a release are passed on first. */
+    uint16_t input(const uint8_t* data, uint16_t size) {
+        const uint16_t total = size;
+        while(!isHeld())
+        {
+            if(this->getReceivedMessageCount() != 0U)
+            {
+                const uint8_t* msg;
+                uint16_t len = this->getReceivedMessage(msg);
+                dispatch(msg, len);
+                continue;
+            }
+            if(size == 0U)
+                break;
+
+            uint16_t used;
+            this->receive(data, size, used);
+            data += used;
+            size -= used;
+        }
+        return total - size;
+    }
+
+protected:
+    void releaseReceived() { this->releaseReceivedMessage(); }
+};
+
+/* HDLC_TL1B link on a file descriptor. */
+template<uint16_t rxBuffLen, class CRC, uint8_t seqMax = 63U, uint8_t noAckLim = 5U,
+        uint8_t window = 0U, bool selective = false>
+class HDLC_TL1B_FD:
+        public HDLC_LINK,
+        public HDLC_TL1B_PORT<rxBuffLen, CRC, seqMax, noAckLim, window, selective>
+{
+public:
+    HDLC_TL1B_FD(int fd):
+        HDLC_LINK(fd),
+        HDLC_TL1B_PORT<rxBuffLen, CRC, seqMax, noAckLim, window, selective>(io())
+    {}
+
+    void poll() {
+        HDLC_TL1B_PORT<rxBuffLen, CRC, seqMax, noAckLim, window, selective>::poll();
+    }
+
+    /* Also drains the frames kept by selective repeat. */
+    uint16_t input(const uint8_t* data, uint16_t size) {
+        const uint16_t total = size;
+        while(!isHeld())
+        {
+            uint16_t used;
+            if(this->receive(data, size, used) != 0U)
+            {
+                const uint8_t* msg;
+                uint16_t len = this->getReceivedMessage(msg);
+                dispatch(msg, len);
+            }
+            else if(used == 0U)
+            {
+                break; /* All used. */
+            }
+            data += used;
+            size -= used;
+        }
+        return total - size;
+    }
+
+protected:
+    void releaseReceived() { this->releaseReceivedMessage(); }
+};
+
+/* HDLC_TL3B_TOKEN link on a file descriptor. */
+template<uint16_t rxBuffLen, class CRC, uint16_t txQueueLen = 0U>
+class HDLC_TL3B_TOKEN_FD:
+        public HDLC_LINK,
+        public HDLC_TL3B_TOKEN_PORT<rxBuffLen, CRC, txQueueLen>
+{
+public:
+    HDLC_TL3B_TOKEN_FD(int fd, uint8_t address, bool master = false):
+        HDLC_LINK(fd),
+        HDLC_TL3B_TOKEN_PORT<rxBuffLen, CRC, txQueueLen>(io(), address, master)
+    {}
+
+    void poll() {
+        HDLC_TL3B_TOKEN_PORT<rxBuffLen, CRC, txQueueLen>::poll();
+    }
+
+    uint16_t input(const uint8_t* data, uint16_t size) {
+        const uint16_t total = size;
+        while(size != 0U && !isHeld())
+        {
+            uint16_t used;
+            if(this->receive(data, size, used) != 0U)
+            {
+                const uint8_t* msg;
+                uint16_t len = this->getMessageData(msg);
+                dispatch(msg, len);
+            }
+            data += used;
+            size -= used;
+        }
+        return total - size;
+    }
+
+protected:
+    void releaseReceived() { this->releaseMessage(); }
+};
+
+/* Waits on epoll for any of its links to become readable and reads only the
+ * ready descriptors. Links whose descriptor hangs up are removed and marked
+ * closed. Pending output is written when epoll reports the descriptor
+ * writable. Every tick (setTick()) the poll() of each link is called, so
+ * retransmission and token timers run while no input arrives. All handlers
+ * run on the thread calling poll() or run(). A link with a held message is
+ * not read; the input it did not use is kept until it is released. */
+class HDLC_LINK_MANAGER {
+public:
+    static const uint16_t RXBFLEN = 4096U;
+    static const int MAXEVENTS = 64;
+
+    HDLC_LINK_MANAGER();
+    ~HDLC_LINK_MANAGER();
+
+    bool add(HDLC_LINK& link);
+    void remove(HDLC_LINK& link);
+    uint16_t getLinkCount() const { return links; }
+
+    /* Poll the links every ms milliseconds, 0 for never. */
+    void setTick(int ms) { tick = ms; }
+    int poll(int timeout);
+    void run();
+    void stop();
+
+private:
+    HDLC_LINK_MANAGER(const HDLC_LINK_MANAGER&);
+    HDLC_LINK_MANAGER& operator=(const HDLC_LINK_MANAGER&);
+
+    friend class HDLC_LINK;
+
+    bool watch(HDLC_LINK& link);
+    void pollLinks();
+    void feed(HDLC_LINK& link, const uint8_t* data, uint16_t size);
+    void resume();
+
+    int epfd;
+    int evfd;
+    std::vector<HDLC_LINK*> stalled;
+    std::mutex mutex;
+    std::vector<HDLC_LINK*> linkList;
+    std::atomic<uint16_t> links;
+    std::atomic<int> tick;
+    uint64_t nextTick;
+    std::atomic<bool> stopping;
+    uint8_t rxBuff[RXBFLEN];
+};
+
+/* Thread per core: one HDLC_LINK_MANAGER and one thread per shard. Links are
+ * spread over the shards as they are added; the handlers of a link always run
+ * on its shard's thread. */
+class HDLC_LINK_SHARDS {
+public:
+    HDLC_LINK_SHARDS(unsigned shards = 0U);
+    ~HDLC_LINK_SHARDS();
+
+    bool add(HDLC_LINK& link);
+    void remove(HDLC_LINK& link);
+    unsigned getShardCount() const { return managers.size(); }
+
+    void setTick(int ms);
+
+    void start();
+    void stop();
+
+private:
+    HDLC_LINK_SHARDS(const HDLC_LINK_SHARDS&);
+    HDLC_LINK_SHARDS& operator=(const HDLC_LINK_SHARDS&);
+
+    std::vector<HDLC_LINK_MANAGER*> managers;
+    std::vector<std::thread> threads;
+    unsigned next;
+};
+
+#endif /* __linux__ */
+
+#endif /* HDLC_LINK_MANAGER_H_ */
@@ -0,0 +1,228 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef HDLC_SCAN_H_
+#define HDLC_SCAN_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/* Escape map: the 256 byte values that are escaped on transmission and, apart
+ * from '~' and '}', discarded on reception when not escaped (RFC 1662 ACCM).
+ * Byte c is bit (c >> 4) & 7 of map[(c & 0x0F) | ((c & 0x80) >> 3)]; this
+ * nibble layout is what the vector search looks up. Build maps with
+ * HDLC_escapeMapInit(). */
+static const uint8_t HDLC_ESCAPEMAPLEN = 32U;
+
+/* '~' and '}' only. A template member so that every translation unit sees
+ * the same address, which selects the faster search. */
+template<class T>
+struct HDLC_ESCAPEMAP {
+    static const uint8_t DEFAULT[HDLC_ESCAPEMAPLEN];
+};
+
+template<class T>
+const uint8_t HDLC_ESCAPEMAP<T>::DEFAULT[HDLC_ESCAPEMAPLEN] = {
+    0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
+    0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x80U, 0x80U, 0x00U,
+    0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
+    0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U
+};
+
+#define HDLC_ESCAPEMAP_DEFAULT (HDLC_ESCAPEMAP<void>::DEFAULT)
+
+static inline bool HDLC_escapeMapTest(const uint8_t* map, uint8_t c)
+{
+    return (map[(c & 0x0FU) | ((c & 0x80U) >> 3U)] >> ((c >> 4U) & 0x07U)) & 1U;
+}
+
+/* Add c to the map. 0x5E cannot be escaped, "}~" aborts the frame, and is
+ * refused: returns false. */
+static inline bool HDLC_escapeMapAdd(uint8_t* map, uint8_t c)
+{
+    if(c == ('~' ^ 0x20U))
+        return false;
+    map[(c & 0x0FU) | ((c & 0x80U) >> 3U)] |= (uint8_t)(1U << ((c >> 4U) & 0x07U));
+    return true;
+}
+
+/* Map of '~', '}' and the control characters 0x00 to 0x1F whose bit is set
+ * in accm (RFC 1662). 0x000A0000 is XON and XOFF. More bytes can be added
+ * with HDLC_escapeMapAdd(). */
+static inline void HDLC_escapeMapInit(uint8_t (&map)[HDLC_ESCAPEMAPLEN],
+        uint32_t accm)
+{
+    memcpy(map, HDLC_ESCAPEMAP_DEFAULT, HDLC_ESCAPEMAPLEN);
+    for(uint8_t c = 0U; c < 32U; ++c)
+    {
+        if((accm >> c) & 1U)
+            HDLC_escapeMapAdd(map, c);
+    }
+}
+
+/* Search for the next byte in an escape map. x86 hosts test 32 bytes at a
+ * time with AVX2 or 16 with SSE2 or SSSE3, picked at run time: the default
+ * map with two compares, other maps with a table lookup per nibble. Other
+ * targets test one byte at a time. Header only, so nothing has to be linked
+ * in. */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+        defined(__SSE2__)
+#define HDLC_SCAN_SIMD
+#include <immintrin.h>
+#endif
+
+static inline uint16_t HDLC_scanBytes(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+    uint16_t i = 0U;
+    while(i < len && !HDLC_escapeMapTest(map, data[i]))
+        ++i;
+    return i;
+}
+
+#if defined(HDLC_SCAN_SIMD)
+
+static inline uint16_t HDLC_scanSSE2(const uint8_t* data, uint16_t len)
+{
+    const __m128i flag = _mm_set1_epi8('~');
+    const __m128i escape = _mm_set1_epi8('}');
+    uint16_t i = 0U;
+    for(; (uint16_t)(len - i) >= 16U; i += 16U)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)&data[i]);
+        const unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(v, flag), _mm_cmpeq_epi8(v, escape)));
+        if(mask != 0U)
+            return i + (uint16_t)__builtin_ctz(mask);
+    }
+    return i + HDLC_scanBytes(&data[i], len - i, HDLC_ESCAPEMAP_DEFAULT);
+}
+
+__attribute__((target("avx2")))
+static inline uint16_t HDLC_scanAVX2(const uint8_t* data, uint16_t len)
+{
+    const __m256i flag = _mm256_set1_epi8('~');
+    const __m256i escape = _mm256_set1_epi8('}');
+    uint16_t i = 0U;
+    for(; (uint16_t)(len - i) >= 32U; i += 32U)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)&data[i]);
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, flag), _mm256_cmpeq_epi8(v, escape)));
+        if(mask != 0U)
+            return i + (uint16_t)__builtin_ctz(mask);
+    }
+    return i + HDLC_scanSSE2(&data[i], len - i);
+}
+
+/* Each byte picks its map row with the low nibble from the half given by its
+ * top bit (pshufb returns 0 for an index with bit 7 set) and tests the bit
+ * given by the other three bits. */
+__attribute__((target("ssse3")))
+static inline uint16_t HDLC_scanSSSE3(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+    const __m128i low = _mm_loadu_si128((const __m128i*)&map[0U]);
+    const __m128i high = _mm_loadu_si128((const __m128i*)&map[16U]);
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i index = _mm_set1_epi8((char)0x8F);
+    const __m128i top = _mm_set1_epi8((char)0x80);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t i = 0U;
+    for(; (uint16_t)(len - i) >= 16U; i += 16U)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)&data[i]);
+        const __m128i x = _mm_and_si128(v, index);
+        const __m128i row = _mm_or_si128(_mm_shuffle_epi8(low, x),
+                _mm_shuffle_epi8(high, _mm_xor_si128(x, top)));
+        const __m128i bit = _mm_shuffle_epi8(bits,
+                _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        const unsigned mask = 0xFFFFU ^ (unsigned)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_and_si128(row, bit), zero));
+        if(mask != 0U)
+            return i + (uint16_t)__builtin_ctz(mask);
+    }
+    return i + HDLC_scanBytes(&data[i], len - i, map);
+}
+
+__attribute__((target("avx2")))
+static inline uint16_t HDLC_scanAVX2(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+    const __m256i low = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i*)&map[0U]));
+    const __m256i high = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i*)&map[16U]));
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i index = _mm256_set1_epi8((char)0x8F);
+    const __m256i top = _mm256_set1_epi8((char)0x80);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    uint16_t i = 0U;
+    for(; (uint16_t)(len - i) >= 32U; i += 32U)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)&data[i]);
+        const __m256i x = _mm256_and_si256(v, index);
+        const __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(low, x),
+                _mm256_shuffle_epi8(high, _mm256_xor_si256(x, top)));
+        const __m256i bit = _mm256_shuffle_epi8(bits,
+                _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        const unsigned mask = ~(unsigned)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero));
+        if(mask != 0U)
+            return i + (uint16_t)__builtin_ctz(mask);
+    }
+    return i + HDLC_scanSSSE3(&data[i], len - i, map);
+}
+
+static inline bool HDLC_hasAVX2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+static inline bool HDLC_hasSSSE3()
+{
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    return ssse3;
+}
+
+#endif
+
+/* Number of bytes before the first one in map, or len if there is none. */
+static inline uint16_t HDLC_scan(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+#if defined(HDLC_SCAN_SIMD)
+    /* Short runs: not worth the vector setup. */
+    if(len < 16U)
+        return HDLC_scanBytes(data, len, map);
+    if(map == HDLC_ESCAPEMAP_DEFAULT)
+        return HDLC_hasAVX2() ? HDLC_scanAVX2(data, len) :
+                HDLC_scanSSE2(data, len);
+    if(HDLC_hasAVX2())
+        return HDLC_scanAVX2(data, len, map);
+    if(HDLC_hasSSSE3())
+        return HDLC_scanSSSE3(data, len, map);
+#endif
+    return HDLC_scanBytes(data, len, map);
+}
+
+#endif /* HDLC_SCAN_H_ */
@@ -0,0 +1,113 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef HDLC_STATS_H_
+#define HDLC_STATS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/* Link statistics. Build with -DHDLC_STATS=1 to count; by default the
+ * counters are compiled out and getStats() returns zeros. Counters are
+ * updated with relaxed atomics, so another thread may take a snapshot while
+ * the link runs. */
+#ifndef HDLC_STATS
+#define HDLC_STATS 0
+#endif
+
+/* Received frame size: bin 0 holds empty frames, bin k frames of 2^(k-1) to
+ * 2^k - 1 bytes. */
+static const uint8_t HDLC_STATS_SIZEBINS = 17U;
+
+/* Escaped bytes per transmitted byte: bin k holds frames with k/8 up to
+ * (k+1)/8 of their bytes escaped, bin 8 frames with all bytes escaped. */
+static const uint8_t HDLC_STATS_ESCAPEBINS = 9U;
+
+struct HDLC_LINK_STATS {
+    /* HDLC */
+    uint32_t rxFrames;
+    uint32_t rxBytes;
+    uint32_t rxEscaped;
+    uint32_t rxEmpty;
+    uint32_t rxCrcErrors;
+    uint32_t rxOversize;
+    uint32_t rxAborted;
+    uint32_t txFrames;
+    uint32_t txBytes;
+    uint32_t txEscaped;
+
+    /* HDLC_TL1B */
+    uint32_t resets;
+    uint32_t retransmits;
+    uint32_t timeouts;
+    uint32_t acksSent;
+    uint32_t nacksSent;
+    uint32_t nacksReceived;
+
+    /* HDLC_TL3B_TOKEN */
+    uint32_t tokenPasses;
+    uint32_t tokenRetries;
+    uint32_t tokenSkips;
+    uint32_t tokenRegenerations;
+
+    uint32_t rxSize[HDLC_STATS_SIZEBINS];
+    uint32_t txEscape[HDLC_STATS_ESCAPEBINS];
+};
+
+static inline uint8_t HDLC_statsSizeBin(uint16_t len)
+{
+    uint8_t bin = 0U;
+    while(len)
+    {
+        ++bin;
+        len >>= 1U;
+    }
+    return bin;
+}
+
+static inline uint8_t HDLC_statsEscapeBin(uint16_t escaped, uint16_t len)
+{
+    return (len != 0U) ? (uint8_t)((uint32_t)escaped * 8U / len) : 0U;
+}
+
+#if HDLC_STATS
+
+#define HDLC_STATS_ADD(field, n)                                               \
+        __atomic_fetch_add(&this->stats.field, (uint32_t)(n), __ATOMIC_RELAXED)
+
+/* Copy or clear a block one counter at a time. */
+static inline void HDLC_statsCopy(HDLC_LINK_STATS& dst, const HDLC_LINK_STATS& src)
+{
+    const uint32_t* from = (const uint32_t*)&src;
+    uint32_t* to = (uint32_t*)&dst;
+    for(size_t i = 0U; i < sizeof(src) / sizeof(uint32_t); ++i)
+        to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+}
+
+static inline void HDLC_statsClear(HDLC_LINK_STATS& stats)
+{
+    uint32_t* to = (uint32_t*)&stats;
+    for(size_t i = 0U; i < sizeof(stats) / sizeof(uint32_t); ++i)
+        __atomic_store_n(&to[i], 0U, __ATOMIC_RELAXED);
+}
+
+#else
+
+#define HDLC_STATS_ADD(field, n) do { } while(0)
+
+#endif /* HDLC_STATS */
+
+#endif /* HDLC_STATS_H_ */
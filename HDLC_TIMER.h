@@ -0,0 +1,148 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef HDLC_TIMER_H_
+#define HDLC_TIMER_H_
+
+#include <stdint.h>
+
+/* Up to N one-shot timers, identified by 0 to N-1, kept in a min-heap by
+ * deadline. Times are ticks of a free running uint32_t clock; comparisons
+ * survive the clock wrapping around. */
+template<uint8_t N>
+class HDLC_TIMERS {
+public:
+    HDLC_TIMERS() { init(); }
+    void init();
+
+    void start(uint8_t id, uint32_t deadline);
+    void stop(uint8_t id);
+
+    bool running(uint8_t id) const { return pos[id] != NONE; }
+    bool empty() const { return count == 0U; }
+
+    bool expired(uint32_t now, uint8_t& id);
+
+private:
+    static const uint8_t NONE = 0xFFU;
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    void place(uint8_t i, uint8_t id);
+    void up(uint8_t i);
+    void down(uint8_t i);
+
+    uint8_t count;
+    uint8_t heap[N];
+    uint8_t pos[N];
+    uint32_t deadlines[N];
+};
+
+template<uint8_t N>
+void HDLC_TIMERS<N>::init()
+{
+    count = 0U;
+    for(uint8_t i = 0U; i < N; ++i)
+        pos[i] = NONE;
+}
+
+/* Start a timer, or move it if it is already running. */
+template<uint8_t N>
+void HDLC_TIMERS<N>::start(uint8_t id, uint32_t deadline)
+{
+    if(pos[id] == NONE)
+    {
+        place(count, id);
+        ++count;
+    }
+    deadlines[id] = deadline;
+    up(pos[id]);
+    down(pos[id]);
+}
+
+template<uint8_t N>
+void HDLC_TIMERS<N>::stop(uint8_t id)
+{
+    const uint8_t i = pos[id];
+    if(i == NONE)
+        return;
+
+    pos[id] = NONE;
+    --count;
+    if(i != count)
+    {
+        const uint8_t last = heap[count];
+        place(i, last);
+        up(i);
+        down(pos[last]);
+    }
+}
+
+/* Remove and return the earliest timer if its deadline is not after now. */
+template<uint8_t N>
+bool HDLC_TIMERS<N>::expired(uint32_t now, uint8_t& id)
+{
+    if(count == 0U || before(now, deadlines[heap[0U]]))
+        return false;
+
+    id = heap[0U];
+    stop(id);
+    return true;
+}
+
+template<uint8_t N>
+void HDLC_TIMERS<N>::place(uint8_t i, uint8_t id)
+{
+    heap[i] = id;
+    pos[id] = i;
+}
+
+template<uint8_t N>
+void HDLC_TIMERS<N>::up(uint8_t i)
+{
+    const uint8_t id = heap[i];
+    while(i != 0U)
+    {
+        const uint8_t parent = (i - 1U) / 2U;
+        if(!before(deadlines[id], deadlines[heap[parent]]))
+            break;
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, id);
+}
+
+template<uint8_t N>
+void HDLC_TIMERS<N>::down(uint8_t i)
+{
+    const uint8_t id = heap[i];
+    for(;;)
+    {
+        uint16_t child = 2U * i + 1U;
+        if(child >= count)
+            break;
+        if(child + 1U < count &&
+                before(deadlines[heap[child + 1U]], deadlines[heap[child]]))
+            ++child;
+        if(!before(deadlines[heap[child]], deadlines[id]))
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, id);
+}
+
+#endif /* HDLC_TIMER_H_ */
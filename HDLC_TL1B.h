@@ -18,12 +18,13 @@
 #define HDLC_TL1B_H_
 
 #define HDLC_TL1B_TEMPLATE                                                     \
-        int16_t (&readByte)(void),                                             \
-        void (&writeByte)(uint8_t data),                                       \
+        class IO,                                                              \
         uint16_t rxBuffLen,                                                    \
         class CRC,                                                             \
         uint8_t seqMax,                                                        \
-        uint8_t noAckLim
+        uint8_t noAckLim,                                                      \
+        uint8_t window,                                                        \
+        bool selective
 
 #define HDLC_TL1B_TEMPLATEDEFAULT                                              \
         int16_t (&readByte)(void),                                             \
@@ -31,27 +32,86 @@
         uint16_t rxBuffLen,                                                    \
         class CRC,                                                             \
         uint8_t seqMax = 63U,                                                  \
-        uint8_t noAckLim = 5U
+        uint8_t noAckLim = 5U,                                                 \
+        void (&writeBlock)(const uint8_t* data, uint16_t len) =                \
+                HDLC_writeBlock<writeByte>,                                    \
+        uint8_t window = 0U,                                                   \
+        bool selective = false
 
 #define HDLC_TL1B_TEMPLATETYPE                                                 \
-        readByte,                                                              \
-        writeByte,                                                             \
+        IO,                                                                    \
         rxBuffLen,                                                             \
         CRC,                                                                   \
         seqMax,                                                                \
-        noAckLim
+        noAckLim,                                                              \
+        window,                                                                \
+        selective
 
 #define HDLC_TL1B_BASE_TEMPLATETYPE                                            \
-        readByte,                                                              \
-        writeByte,                                                             \
+        IO,                                                                    \
+        rxBuffLen + 2U,                                                        \
+        CRC,                                                                   \
+        1U,                                                                    \
+        HDLC_DEFRAME_DEFAULT
+
+#define HDLC_TL1B_NOWINDOW_TEMPLATE                                            \
+        class IO,                                                              \
+        uint16_t rxBuffLen,                                                    \
+        class CRC,                                                             \
+        uint8_t seqMax,                                                        \
+        uint8_t noAckLim,                                                      \
+        bool selective
+
+#define HDLC_TL1B_NOWINDOW_TEMPLATETYPE                                        \
+        IO,                                                                    \
+        rxBuffLen,                                                             \
+        CRC,                                                                   \
+        seqMax,                                                                \
+        noAckLim,                                                              \
+        0U,                                                                    \
+        selective
+
+#define HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE                                   \
+        IO,                                                                    \
         rxBuffLen + 1U,                                                        \
-        CRC
+        CRC,                                                                   \
+        1U,                                                                    \
+        HDLC_DEFRAME_DEFAULT
 
 #include "HDLC.h"
+#include "HDLC_TIMER.h"
 
-template<HDLC_TL1B_TEMPLATEDEFAULT>
-class HDLC_TL1B:
-        private HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>
+/* Window mode (window > 0): up to window DATA frames are kept until
+ * acknowledged. ACKs are cumulative and frames are delivered in order.
+ * Go-Back-N discards out of order frames and retransmit() sends every
+ * unacknowledged frame again. Selective repeat (selective = true) keeps out
+ * of order frames, asks for the missing one with a NACK and retransmit()
+ * sends only the oldest frame. A received RESET renumbers the unacknowledged
+ * frames from 0 and sends them again.
+ *
+ * Given a clock with setClock(), each frame in the window has a retransmission
+ * timer. The timeout follows the measured round trip time (SRTT + 4 RTTVAR,
+ * RFC 6298), doubles on every expiry and ignores retransmitted frames (Karn).
+ * The timers are checked by receive() and poll().
+ *
+ * A frame with a bad CRC, a frame too long for the buffer or a frame out of
+ * order makes the receiver send one NACK for the frame it expects. The sender
+ * retransmits from that frame at once.
+ *
+ * A DATA frame has a second header byte, ACK | sequence, with the cumulative
+ * ACK of the other direction. With setAckDelay() the receiver waits for a
+ * number of frames or ticks before sending a separate ACK frame, so that the
+ * ACK can ride on outgoing DATA instead.
+ *
+ * A message is kept for retransmission, so it must fit in rxBuffLen bytes.
+ * transmitBlock() and transmitGather() refuse a longer one and return false.
+ * A longer frame written with transmitByte() or transmitBytes() is aborted on
+ * the line and transmitEnd() returns false.
+ *
+ * window = 0 is a specialization below, without any of this state. */
+template<HDLC_TL1B_TEMPLATE>
+class HDLC_TL1B_CORE:
+        private HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>
 {
 private:
     static const uint8_t MASK    = 0xC0U;
@@ -61,129 +121,496 @@ private:
     static const uint8_t NACK    = 0x80U;
     static const uint8_t DATA    = 0xC0U;
 
+    static const uint8_t HEADLEN = 2U;
+    static const uint8_t TXSLOTS = window;
+    static const uint8_t ACKTIMER = TXSLOTS;
+    static const uint16_t TXSLOTLEN = rxBuffLen;
+    static const uint8_t RXSLOTS = selective ? window : 1U;
+    static const uint16_t RXSLOTLEN = selective ? rxBuffLen : 1U;
+
+    static_assert(seqMax <= MASKINV, "seqMax must fit in 6 bits");
+    static_assert(window <= (selective ? (seqMax + 1U) / 2U : seqMax),
+            "window too large for the sequence numbers");
+
 public:
     static const uint16_t RXBFLEN = rxBuffLen;
 
-    HDLC_TL1B();
+    HDLC_TL1B_CORE(const IO& io = IO());
     void init();
 
     void transmitReset();
-    void transmitBlock(const void* vdata, uint16_t len);
+    bool transmitBlock(const void* vdata, uint16_t len);
+    bool transmitGather(const HDLC_SEGMENT* seg, uint16_t count);
 
-    void transmitStart();
+    bool transmitStart();
     void transmitByte(uint8_t data);
     void transmitBytes(const void* vdata, uint16_t len);
-    void transmitEnd();
+    bool transmitEnd();
+
+    /* Worst-case encoded size of a DATA frame, header included. */
+    static constexpr uint32_t encodedSizeMax(uint16_t len) {
+        return HDLC_encodedSizeMax<CRC>((uint32_t)HEADLEN + len);
+    }
 
     uint16_t receive();
+    uint16_t receive(const void* vdata, uint16_t size, uint16_t& used);
 
     uint16_t copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const;
 
+    uint16_t getReceivedMessage(const uint8_t*& msg) const;
+    void holdReceivedMessage();
+    void releaseReceivedMessage();
+
+    bool transmitReady() const { return txCount < window; }
+    uint8_t getTransmitPending() const { return txCount; }
+    void retransmit();
+
+    typedef uint32_t (*Clock_t)(void);
+    void setClock(Clock_t clock) { this->clock = clock; }
+    void setRetransmitTimeout(uint32_t initial, uint32_t min, uint32_t max);
+    void setAckDelay(uint8_t frames, uint32_t ticks);
+    void poll();
+    uint32_t getRtt() const { return srtt >> 3U; }
+    uint32_t getRto() const { return rto; }
+
+    using HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::getStats;
+    using HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::resetStats;
+    using HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::setEscapeMap;
+    using HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::getEscapeMap;
+
 private:
+    uint16_t receiveFrame(uint16_t datalen);
+    uint16_t receivePending();
+    uint16_t receiveData(uint8_t rxs, uint16_t datalen);
+    void receiveError();
+    void receiveAck(uint8_t rxs);
+    void receiveNack(uint8_t rxs);
+    void receiveReset();
+    uint16_t deliver(const uint8_t* msg, uint16_t datalen);
+
     void transmitAck(uint8_t rxs);
     void transmitNack(uint8_t rxs);
+    void transmitAckDelayed();
+    void transmitAckNow();
+    void transmitHeader(uint8_t seq);
+    void transmitAbort();
+    void retransmitFrame(uint8_t n);
+    void startTimer(uint8_t slot);
+    void rttSample(uint32_t rtt);
+
+    static uint8_t seqAdd(uint8_t seq, uint8_t n) {
+        return (uint8_t)((seq + n) % (seqMax + 1U));
+    }
+    static uint8_t seqDiff(uint8_t a, uint8_t b) {
+        return (uint8_t)((a + (seqMax + 1U) - b) % (seqMax + 1U));
+    }
 
     uint8_t count_seq;
-    uint8_t count_tx_noack;
+
+    /* Transmit: txCount unacknowledged frames starting with
+     * sequence txBase in slot txSlot. txOpen while a frame is written. */
+    bool txOpen;
+    uint8_t txBase;
+    uint8_t txSlot;
+    uint8_t txCount;
+    uint16_t txLen[TXSLOTS];
+    uint8_t txData[TXSLOTS][TXSLOTLEN];
+
+    /* Retransmission timers, one per transmit slot, and the delayed ACK
+     * timer. srtt is scaled by 8 and rttvar by 4; srtt is 0 until the first
+     * sample. */
+    Clock_t clock;
+    HDLC_TIMERS<TXSLOTS + 1U> timers;
+    uint32_t txTime[TXSLOTS];
+    bool txRetx[TXSLOTS];
+    uint32_t srtt;
+    uint32_t rttvar;
+    uint32_t rto;
+    uint32_t rtoInit;
+    uint32_t rtoMin;
+    uint32_t rtoMax;
+
+    /* In order frames received and not acknowledged yet. */
+    uint8_t ackPending;
+    uint8_t ackFrames;
+    uint32_t ackTicks;
+
+    /* Receive: every frame before rxExpected was received, and
+     * the ones from rxNext are not delivered yet. Selective repeat keeps them
+     * in slots starting at rxSlot. */
+    uint8_t rxExpected;
+    uint8_t rxNext;
+    uint8_t rxSlot;
+    bool rxNacked;
+    bool rxHeld;
+    const uint8_t* rxMsg;
+    uint16_t rxMsgLen;
+    bool rxPresent[RXSLOTS];
+    uint16_t rxLen[RXSLOTS];
+    uint8_t rxData[RXSLOTS][RXSLOTLEN];
 };
 
 template<HDLC_TL1B_TEMPLATE>
-HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::HDLC_TL1B()
+HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::HDLC_TL1B_CORE(const IO& io):
+        HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>(io)
 {
+    clock = 0;
+    setRetransmitTimeout(1000U, 10U, 60000U);
+    setAckDelay(1U, 0U);
     init();
 }
 
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::init()
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::init()
 {
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::init();
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::init();
     count_seq = seqMax;
-    count_tx_noack = 0U;
+
+    txOpen = false;
+    txBase = 0U;
+    txSlot = 0U;
+    txCount = 0U;
+    timers.init();
+    ackPending = 0U;
+
+    rxExpected = 0U;
+    rxNext = 0U;
+    rxSlot = 0U;
+    rxNacked = false;
+    rxHeld = false;
+    rxMsg = 0;
+    rxMsgLen = 0U;
+    for(uint8_t i = 0U; i < RXSLOTS; ++i)
+        rxPresent[i] = false;
 }
 
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitReset()
 {
     init();
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(RESET);
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+    HDLC_STATS_ADD(resets, 1U);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(RESET);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
 }
 
+/* Returns false if the message was not sent. */
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+bool HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitBlock(const void* vdata, uint16_t len)
 {
-    transmitStart();
+    if(len > TXSLOTLEN || !transmitStart())
+        return false;
+
     transmitBytes(vdata, len);
-    transmitEnd();
+    return transmitEnd();
 }
 
+/* One DATA frame from several buffers, without copying them together. */
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+bool HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        transmitGather(const HDLC_SEGMENT* seg, uint16_t count)
+{
+    uint32_t len = 0U;
+    for(uint16_t i = 0U; i < count; ++i)
+        len += seg[i].len;
+    if(len > TXSLOTLEN || !transmitStart())
+        return false;
+
+    for(uint16_t i = 0U; i < count; ++i)
+        transmitBytes(seg[i].data, seg[i].len);
+    return transmitEnd();
+}
+
+/* Returns false, and sends nothing, if the window is full. The frame can be
+ * sent once ACKs arrive, see transmitReady(). */
+template<HDLC_TL1B_TEMPLATE>
+bool HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitStart()
 {
-    if(++count_tx_noack >= noAckLim)
-        transmitReset();
+    if(txCount >= window)
+        return false;
+    txLen[(txSlot + txCount) % TXSLOTS] = 0U;
+    txOpen = true;
 
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
     count_seq = (count_seq < seqMax) ? (count_seq + 1U) : 0U;
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(DATA | count_seq);
+    transmitHeader(count_seq);
+    return true;
+}
+
+/* Start a DATA frame. The ACK for the other direction goes with it. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::transmitHeader(uint8_t seq)
+{
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(DATA | seq);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(
+            ACK | seqAdd(rxExpected, seqMax));
+    ackPending = 0U;
+    timers.stop(ACKTIMER);
 }
 
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitByte(uint8_t data)
 {
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(data);
+    if(!txOpen)
+        return;
+
+    const uint8_t slot = (txSlot + txCount) % TXSLOTS;
+    if(txLen[slot] == TXSLOTLEN)
+    {
+        transmitAbort();
+        return;
+    }
+    txData[slot][txLen[slot]++] = data;
+
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(data);
 }
 
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitBytes(const void* vdata, uint16_t len)
 {
-    const uint8_t* data = (const uint8_t*)vdata;
-    while(len)
+    if(!txOpen)
+        return;
+
+    const uint8_t slot = (txSlot + txCount) % TXSLOTS;
+    if(len > TXSLOTLEN - txLen[slot])
     {
-        transmitByte(*data);
-        ++data;
-        --len;
+        transmitAbort();
+        return;
     }
+    memcpy(&txData[slot][txLen[slot]], vdata, len);
+    txLen[slot] += len;
+
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitBytes(vdata, len);
 }
 
+/* Returns false if the frame was aborted. */
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::transmitEnd()
+bool HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::transmitEnd()
 {
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+    if(!txOpen)
+        return false;
+
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+    txOpen = false;
+
+    const uint8_t slot = (txSlot + txCount) % TXSLOTS;
+    txRetx[slot] = false;
+    startTimer(slot);
+    ++txCount;
+    return true;
+}
+
+/* The frame does not fit its retransmit slot. Abort it, take back its
+ * sequence number and send the ACK it carried on its own. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::transmitAbort()
+{
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitAbort();
+    txOpen = false;
+    count_seq = seqAdd(count_seq, seqMax);
+    transmitAckNow();
 }
 
+/* Send unacknowledged frames again, to be called when no ACK came in time.
+ * Go-Back-N sends them all, selective repeat only the oldest. */
 template<HDLC_TL1B_TEMPLATE>
-uint16_t HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::receive()
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::retransmit()
 {
-    uint16_t datalen = HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::receive();
+    const uint8_t num = selective ? ((txCount != 0U) ? 1U : 0U) : txCount;
+    for(uint8_t n = 0U; n < num; ++n)
+        retransmitFrame(n);
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::retransmitFrame(uint8_t n)
+{
+    const uint8_t slot = (txSlot + n) % TXSLOTS;
+    HDLC_STATS_ADD(retransmits, 1U);
+    transmitHeader(seqAdd(txBase, n));
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitBytes(txData[slot], txLen[slot]);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+    txRetx[slot] = true;
+    startTimer(slot);
+}
+
+/* Times are in ticks of the clock. The timeout starts at initial and is kept
+ * between min and max. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        setRetransmitTimeout(uint32_t initial, uint32_t min, uint32_t max)
+{
+    rtoInit = initial;
+    rtoMin = min;
+    rtoMax = max;
+    rto = initial;
+    srtt = 0U;
+    rttvar = 0U;
+}
+
+/* Send a delayed ACK and retransmit the frames whose timer expired. Go-Back-N
+ * sends the whole window again, selective repeat only the expired frames. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::poll()
+{
+    if(clock == 0 || timers.empty())
+        return;
+
+    const uint32_t now = clock();
+    bool expired = false;
+    uint8_t id;
+    while(timers.expired(now, id))
+    {
+        if(id == ACKTIMER)
+        {
+            transmitAckNow();
+            continue;
+        }
+
+        if(!expired)
+            rto = (rto > rtoMax / 2U) ? rtoMax : (2U * rto);
+        expired = true;
+        HDLC_STATS_ADD(timeouts, 1U);
+
+        if(selective)
+            retransmitFrame((id + TXSLOTS - txSlot) % TXSLOTS);
+    }
+
+    if(expired && !selective)
+        retransmit();
+}
+
+/* ACK after frames in order frames, or ticks after the first of them,
+ * whichever comes first. Out of order and duplicate frames are answered at
+ * once. Without a clock ACKs are not delayed. Keep ticks below the peer's
+ * minimum retransmission timeout and frames below its window. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        setAckDelay(uint8_t frames, uint32_t ticks)
+{
+    ackFrames = (frames != 0U) ? frames : 1U;
+    ackTicks = ticks;
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::startTimer(uint8_t slot)
+{
+    if(clock == 0)
+        return;
+    txTime[slot] = clock();
+    timers.start(slot, txTime[slot] + rto);
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::rttSample(uint32_t rtt)
+{
+    if(rtt == 0U)
+        rtt = 1U;
+
+    if(srtt == 0U)
+    {
+        srtt = rtt << 3U;
+        rttvar = rtt << 1U;
+    }
+    else
+    {
+        const int32_t err = (int32_t)(rtt - (srtt >> 3U));
+        srtt += err;
+        rttvar += ((err < 0) ? -err : err) - (int32_t)(rttvar >> 2U);
+    }
+
+    rto = (srtt >> 3U) + rttvar;
+    if(rto < rtoMin)
+        rto = rtoMin;
+    if(rto > rtoMax)
+        rto = rtoMax;
+}
+
+template<HDLC_TL1B_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receive()
+{
+    poll();
+    if(rxHeld)
+        return 0U;
+
+    uint16_t datalen = receivePending();
+    if(datalen != 0U)
+        return datalen;
+
+    datalen = HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::receive();
+    return receiveFrame(datalen);
+}
+
+/* Nothing is consumed while a message is held or while selective repeat
+ * delivers frames it kept. */
+template<HDLC_TL1B_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        receive(const void* vdata, uint16_t size, uint16_t& used)
+{
+    used = 0U;
+    poll();
+    if(rxHeld)
+        return 0U;
+
+    uint16_t datalen = receivePending();
+    if(datalen != 0U)
+        return datalen;
+
+    datalen = HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::
+            receive(vdata, size, used);
+    return receiveFrame(datalen);
+}
+
+template<HDLC_TL1B_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receiveFrame(uint16_t datalen)
+{
+    if(datalen == 0U &&
+            (HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::receiveCrcError() ||
+            HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::receiveOversize()))
+    {
+        /* Damaged, or too long for the buffer. */
+        receiveError();
+    }
+
     if(datalen != 0U)
     {
         datalen -= 1U;
 
-        uint8_t frameseq;
-        HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::copyReceivedMessage(&frameseq, 0U, 1U);
+        uint8_t frameseq = 0U;
+        HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::copyReceivedMessage(&frameseq, 0U, 1U);
 
         uint8_t frame = frameseq & MASK;
         uint8_t rxs = frameseq & MASKINV;
         if(frame == DATA)
         {
-            transmitAck(rxs);
+            if(datalen != 0U)
+            {
+                uint8_t ack = 0U;
+                HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::copyReceivedMessage(&ack, 1U, 1U);
+                if((ack & MASK) == ACK)
+                {
+                    HDLC_TRACE_EVENT(HDLC_TRACE_ACK_RX, ack & MASKINV);
+                    receiveAck(ack & MASKINV);
+                }
+                datalen = receiveData(rxs, datalen - 1U);
+            }
         }
         else if(frame == ACK)
         {
-            count_tx_noack = 0U;
+            HDLC_TRACE_EVENT(HDLC_TRACE_ACK_RX, rxs);
+            receiveAck(rxs);
         }
         else if(frame == NACK)
         {
+            receiveNack(rxs);
         }
         else if(frame == RESET)
         {
+            receiveReset();
         }
         else
         {
@@ -193,34 +620,516 @@ uint16_t HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::receive()
 }
 
 template<HDLC_TL1B_TEMPLATE>
-uint16_t HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        receiveData(uint8_t rxs, uint16_t datalen)
+{
+    const uint8_t off = seqDiff(rxs, rxNext);
+    const uint8_t pending = seqDiff(rxExpected, rxNext);
+
+    const uint8_t expected = rxExpected;
+
+    if(off < pending || off >= window)
+    {
+        /* Duplicate or outside the window. Repeat the last ACK. */
+        transmitAckNow();
+        return 0U;
+    }
+
+    const uint8_t* msg;
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::getReceivedMessage(msg);
+    msg += HEADLEN; /* Skip frame/sequence and ACK bytes. */
+
+    if(off == 0U)
+    {
+        /* In order: deliver straight from the receive buffer. */
+        rxExpected = seqAdd(rxs, 1U);
+        rxNext = rxExpected;
+        rxSlot = (rxSlot + 1U) % RXSLOTS;
+        rxNacked = false;
+    }
+    else if(!selective)
+    {
+        /* Go-Back-N: a frame was lost. Drop this one and ask the sender to
+         * go back to rxExpected. */
+        receiveError();
+        return 0U;
+    }
+    else
+    {
+        const uint8_t slot = (rxSlot + off) % RXSLOTS;
+        if(!rxPresent[slot])
+        {
+            rxLen[slot] = (datalen > RXSLOTLEN) ? RXSLOTLEN : datalen;
+            memcpy(rxData[slot], msg, rxLen[slot]);
+            rxPresent[slot] = true;
+        }
+        datalen = 0U;
+    }
+
+    if(selective)
+    {
+        /* Take in the kept frames that are now in order. */
+        uint8_t n = seqDiff(rxExpected, rxNext);
+        while(n < window && rxPresent[(rxSlot + n) % RXSLOTS])
+        {
+            rxExpected = seqAdd(rxExpected, 1U);
+            ++n;
+        }
+
+        /* Ask once for the first missing frame if later ones are kept. */
+        bool gap = false;
+        for(uint8_t i = n + 1U; i < window; ++i)
+            gap = gap || rxPresent[(rxSlot + i) % RXSLOTS];
+        if(!gap)
+        {
+            rxNacked = false;
+        }
+        else if(!rxNacked)
+        {
+            transmitNack(rxExpected);
+            rxNacked = true;
+        }
+    }
+
+    if(rxExpected != expected)
+        transmitAckDelayed();
+    return (datalen != 0U) ? deliver(msg, datalen) : 0U;
+}
+
+/* Count a frame received in order and send the ACK when it is due. The
+ * delayed ACK timer starts with the first frame not acknowledged. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::transmitAckDelayed()
+{
+    ++ackPending;
+    if(clock == 0 || ackTicks == 0U || ackPending >= ackFrames)
+        transmitAckNow();
+    else if(ackPending == 1U)
+        timers.start(ACKTIMER, clock() + ackTicks);
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::transmitAckNow()
+{
+    ackPending = 0U;
+    timers.stop(ACKTIMER);
+    transmitAck(seqAdd(rxExpected, seqMax));
+}
+
+/* A frame was lost or damaged. Ask once for the next expected frame so the
+ * sender retransmits it without waiting for its timer. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receiveError()
+{
+    if(!rxNacked)
+    {
+        transmitNack(rxExpected);
+        rxNacked = true;
+    }
+}
+
+/* Deliver the next kept frame, if it is in order. Frames without data are
+ * skipped. */
+template<HDLC_TL1B_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receivePending()
+{
+    if(!selective)
+        return 0U;
+
+    while(rxNext != rxExpected)
+    {
+        const uint8_t slot = rxSlot;
+        rxPresent[slot] = false;
+        rxSlot = (rxSlot + 1U) % RXSLOTS;
+        rxNext = seqAdd(rxNext, 1U);
+        if(rxLen[slot] != 0U)
+            return deliver(rxData[slot], rxLen[slot]);
+    }
+    return 0U;
+}
+
+template<HDLC_TL1B_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        deliver(const uint8_t* msg, uint16_t datalen)
+{
+    rxMsg = msg;
+    rxMsgLen = datalen;
+    HDLC_TRACE_EVENT(HDLC_TRACE_DELIVER, datalen);
+    return datalen;
+}
+
+/* Cumulative ACK: every frame up to rxs was received. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receiveAck(uint8_t rxs)
+{
+    const uint8_t n = seqDiff(rxs, txBase) + 1U;
+    if(n <= txCount)
+    {
+        /* Time the oldest frame: a delayed ACK counts in its round trip. */
+        if(clock != 0 && !txRetx[txSlot])
+            rttSample(clock() - txTime[txSlot]);
+        for(uint8_t i = 0U; i < n; ++i)
+            timers.stop((txSlot + i) % TXSLOTS);
+
+        txBase = seqAdd(txBase, n);
+        txSlot = (txSlot + n) % TXSLOTS;
+        txCount -= n;
+    }
+}
+
+/* Frame rxs is missing, every frame before it was received. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receiveNack(uint8_t rxs)
+{
+    HDLC_STATS_ADD(nacksReceived, 1U);
+    receiveAck(seqAdd(rxs, seqMax));
+    if(txCount != 0U && rxs == txBase)
+        retransmit();
+}
+
+/* The peer starts over from sequence 0. Renumber and send again the frames
+ * it did not acknowledge. */
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::receiveReset()
+{
+    HDLC_STATS_ADD(resets, 1U);
+    rxExpected = 0U;
+    rxNext = 0U;
+    rxSlot = 0U;
+    rxNacked = false;
+    for(uint8_t i = 0U; i < RXSLOTS; ++i)
+        rxPresent[i] = false;
+
+    txBase = 0U;
+    count_seq = seqAdd(txCount, seqMax);
+    for(uint8_t n = 0U; n < txCount; ++n)
+        retransmitFrame(n);
+}
+
+template<HDLC_TL1B_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const
 {
-    uint16_t datalen = HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::
-            copyReceivedMessage(buff, 1U, RXBFLEN);
+    const uint8_t* msg;
+    const uint16_t datalen = getReceivedMessage(msg);
+    memcpy(buff, msg, datalen);
     return datalen;
 }
 
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
+        getReceivedMessage(const uint8_t*& msg) const
+{
+    msg = rxMsg;
+    return rxMsgLen;
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::holdReceivedMessage()
+{
+    rxHeld = (rxMsgLen != 0U);
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::releaseReceivedMessage()
+{
+    rxHeld = false;
+    rxMsgLen = 0U;
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::releaseReceivedMessage();
+}
+
+template<HDLC_TL1B_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitAck(uint8_t rxs)
 {
     rxs &= MASKINV;
     rxs |= ACK;
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(rxs);
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+    HDLC_STATS_ADD(acksSent, 1U);
+    HDLC_TRACE_EVENT(HDLC_TRACE_ACK_TX, rxs & MASKINV);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(rxs);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
 }
 
 template<HDLC_TL1B_TEMPLATE>
-void HDLC_TL1B<HDLC_TL1B_TEMPLATETYPE>::
+void HDLC_TL1B_CORE<HDLC_TL1B_TEMPLATETYPE>::
         transmitNack(uint8_t rxs)
 {
     rxs &= MASKINV;
     rxs |= NACK;
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(rxs);
-    HDLC<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+    HDLC_STATS_ADD(nacksSent, 1U);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitByte(rxs);
+    HDLC_CORE<HDLC_TL1B_BASE_TEMPLATETYPE>::transmitEnd();
+
+    /* A NACK also acknowledges the frames before it. */
+    ackPending = 0U;
+    timers.stop(ACKTIMER);
 }
 
+/* window = 0: every DATA frame is acknowledged and delivered as it comes and
+ * nothing is retransmitted; after noAckLim frames without ACK the link is
+ * reset. None of the window mode state is kept. The clock, timeout and ACK
+ * delay calls are accepted and do nothing. */
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+class HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>:
+        private HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>
+{
+private:
+    static const uint8_t MASK    = 0xC0U;
+    static const uint8_t MASKINV = 0x3FU;
+    static const uint8_t RESET   = 0x00U;
+    static const uint8_t ACK     = 0x40U;
+    static const uint8_t NACK    = 0x80U;
+    static const uint8_t DATA    = 0xC0U;
+
+    static_assert(seqMax <= MASKINV, "seqMax must fit in 6 bits");
+
+public:
+    static const uint16_t RXBFLEN = rxBuffLen;
+
+    HDLC_TL1B_CORE(const IO& io = IO());
+    void init();
+
+    void transmitReset();
+    bool transmitBlock(const void* vdata, uint16_t len);
+    bool transmitGather(const HDLC_SEGMENT* seg, uint16_t count);
+
+    bool transmitStart();
+    void transmitByte(uint8_t data);
+    void transmitBytes(const void* vdata, uint16_t len);
+    bool transmitEnd();
+
+    /* Worst-case encoded size of a DATA frame, header included. */
+    static constexpr uint32_t encodedSizeMax(uint16_t len) {
+        return HDLC_encodedSizeMax<CRC>(1U + (uint32_t)len);
+    }
+
+    uint16_t receive();
+    uint16_t receive(const void* vdata, uint16_t size, uint16_t& used);
+
+    uint16_t copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const;
+
+    uint16_t getReceivedMessage(const uint8_t*& msg) const;
+    void holdReceivedMessage();
+    void releaseReceivedMessage();
+
+    bool transmitReady() const { return true; }
+    uint8_t getTransmitPending() const { return 0U; }
+    void retransmit() {}
+
+    typedef uint32_t (*Clock_t)(void);
+    void setClock(Clock_t) {}
+    void setRetransmitTimeout(uint32_t, uint32_t, uint32_t) {}
+    void setAckDelay(uint8_t, uint32_t) {}
+    void poll() {}
+    uint32_t getRtt() const { return 0U; }
+    uint32_t getRto() const { return 0U; }
+
+    using HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::getStats;
+    using HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::resetStats;
+    using HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::setEscapeMap;
+    using HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::getEscapeMap;
+
+private:
+    uint16_t receiveFrame(uint16_t datalen);
+    void transmitAck(uint8_t rxs);
+
+    uint8_t count_seq;
+    uint8_t count_tx_noack;
+};
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::HDLC_TL1B_CORE(const IO& io):
+        HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>(io)
+{
+    init();
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::init()
+{
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::init();
+    count_seq = seqMax;
+    count_tx_noack = 0U;
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitReset()
+{
+    init();
+    HDLC_STATS_ADD(resets, 1U);
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitByte(RESET);
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitEnd();
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+bool HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitBlock(const void* vdata, uint16_t len)
+{
+    transmitStart();
+    transmitBytes(vdata, len);
+    return transmitEnd();
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+bool HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitGather(const HDLC_SEGMENT* seg, uint16_t count)
+{
+    transmitStart();
+    for(uint16_t i = 0U; i < count; ++i)
+        transmitBytes(seg[i].data, seg[i].len);
+    return transmitEnd();
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+bool HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitStart()
+{
+    if(++count_tx_noack >= noAckLim)
+        transmitReset();
+
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitStart();
+    count_seq = (count_seq < seqMax) ? (count_seq + 1U) : 0U;
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitByte(DATA | count_seq);
+    return true;
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitByte(uint8_t data)
+{
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitByte(data);
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitBytes(const void* vdata, uint16_t len)
+{
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitBytes(vdata, len);
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+bool HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::transmitEnd()
+{
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitEnd();
+    return true;
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::receive()
+{
+    uint16_t datalen = HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::receive();
+    return receiveFrame(datalen);
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        receive(const void* vdata, uint16_t size, uint16_t& used)
+{
+    uint16_t datalen = HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::
+            receive(vdata, size, used);
+    return receiveFrame(datalen);
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        receiveFrame(uint16_t datalen)
+{
+    if(datalen != 0U)
+    {
+        datalen -= 1U;
+
+        uint8_t frameseq = 0U;
+        HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::
+                copyReceivedMessage(&frameseq, 0U, 1U);
+
+        uint8_t frame = frameseq & MASK;
+        uint8_t rxs = frameseq & MASKINV;
+        if(frame == DATA)
+        {
+            transmitAck(rxs);
+            HDLC_TRACE_EVENT(HDLC_TRACE_DELIVER, datalen);
+        }
+        else if(frame == ACK)
+        {
+            count_tx_noack = 0U;
+            HDLC_TRACE_EVENT(HDLC_TRACE_ACK_RX, rxs);
+        }
+        else
+        {
+        }
+    }
+    return datalen;
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        copyReceivedMessage(uint8_t (&buff)[RXBFLEN]) const
+{
+    uint16_t datalen = HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::
+            copyReceivedMessage(buff, 1U, RXBFLEN);
+    return datalen;
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+uint16_t HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        getReceivedMessage(const uint8_t*& msg) const
+{
+    uint16_t datalen = HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::
+            getReceivedMessage(msg);
+    ++msg; /* Skip frame/sequence byte. */
+    return (datalen != 0U) ? (datalen - 1U) : 0U;
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::holdReceivedMessage()
+{
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::holdReceivedMessage();
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::releaseReceivedMessage()
+{
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::releaseReceivedMessage();
+}
+
+template<HDLC_TL1B_NOWINDOW_TEMPLATE>
+void HDLC_TL1B_CORE<HDLC_TL1B_NOWINDOW_TEMPLATETYPE>::
+        transmitAck(uint8_t rxs)
+{
+    rxs &= MASKINV;
+    rxs |= ACK;
+    HDLC_STATS_ADD(acksSent, 1U);
+    HDLC_TRACE_EVENT(HDLC_TRACE_ACK_TX, rxs & MASKINV);
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitByte(rxs);
+    HDLC_CORE<HDLC_TL1B_NOWINDOW_BASE_TEMPLATETYPE>::transmitEnd();
+}
+
+/* HDLC_TL1B with I/O functions given as template arguments. */
+template<HDLC_TL1B_TEMPLATEDEFAULT>
+class HDLC_TL1B:
+        public HDLC_TL1B_CORE<
+                HDLC_IO_FUNC<readByte, writeByte, writeBlock>,
+                rxBuffLen, CRC, seqMax, noAckLim, window, selective>
+{
+};
+
+/* HDLC_TL1B with I/O bound at run time. */
+template<uint16_t rxBuffLen, class CRC, uint8_t seqMax = 63U, uint8_t noAckLim = 5U,
+        uint8_t window = 0U, bool selective = false>
+class HDLC_TL1B_PORT:
+        public HDLC_TL1B_CORE<HDLC_IO_PORT, rxBuffLen, CRC, seqMax, noAckLim,
+                window, selective>
+{
+public:
+    HDLC_TL1B_PORT(const HDLC_IO_PORT& io):
+        HDLC_TL1B_CORE<HDLC_IO_PORT, rxBuffLen, CRC, seqMax, noAckLim,
+                window, selective>(io)
+    {}
+};
+
 #endif /* HDLC_TL1B_H_ */
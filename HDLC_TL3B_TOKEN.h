@@ -20,26 +20,51 @@
 #include "HDLC.h"
 
 #define HDLC_TL3B_TOKEN_TEMPLATE                                               \
+        class IO,                                                              \
+        uint16_t rxBuffLen,                                                    \
+        class CRC,                                                             \
+        uint16_t txQueueLen
+
+#define HDLC_TL3B_TOKEN_TEMPLATEDEFAULT                                        \
         int16_t (&readByte)(void),                                             \
         void (&writeByte)(uint8_t data),                                       \
         uint16_t rxBuffLen,                                                    \
-        class CRC
+        class CRC,                                                             \
+        void (&writeBlock)(const uint8_t* data, uint16_t len) =                \
+                HDLC_writeBlock<writeByte>,                                    \
+        uint16_t txQueueLen = 0U
 
 #define HDLC_TL3B_TOKEN_TEMPLATETYPE                                           \
-        readByte,                                                              \
-        writeByte,                                                             \
+        IO,                                                                    \
         rxBuffLen,                                                             \
-        CRC
+        CRC,                                                                   \
+        txQueueLen
 
 #define HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE                                      \
-        readByte,                                                              \
-        writeByte,                                                             \
+        IO,                                                                    \
         rxBuffLen,                                                             \
-        CRC
-
+        CRC,                                                                   \
+        1U,                                                                    \
+        HDLC_DEFRAME_DEFAULT
+
+/* Token scheduler. With a ring of station addresses set by setRing(), a
+ * station holding the token sends the messages queued with queueWrite() and
+ * queueRead() in one burst. It then gives the token to the next station in
+ * the ring. A burst ends when the queue is empty, after maxFrames frames, or
+ * after maxTicks ticks of the clock (setTokenHold()). The queue holds
+ * txQueueLen bytes, with 4 bytes of overhead per message. The scheduler runs
+ * in receive() and poll().
+ *
+ * Token recovery (setTokenTimeout(), needs a clock). A GIVE_TOKEN with no
+ * answer within passTicks is sent again; any frame from the new holder counts
+ * as an answer. After TOKEN_RETRIES retries the token goes to the station
+ * after it in the ring, or stays here without a ring. A station without the
+ * token that sees no frame for lossTicks + rank * passTicks takes the token
+ * with transmitReset(). The rank is the position in the ring, or the address
+ * without a ring, so the stations do not time out together. */
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-class HDLC_TL3B_TOKEN:
-        private HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>
+class HDLC_TL3B_TOKEN_CORE:
+        private HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>
 {
 public:
     enum Command_t {
@@ -64,7 +89,9 @@ public:
 
     static const uint16_t RXBFLEN = rxBuffLen;
 
-    HDLC_TL3B_TOKEN(uint8_t address, bool master = false);
+    typedef uint32_t (*Clock_t)(void);
+
+    HDLC_TL3B_TOKEN_CORE(const IO& io, uint8_t address, bool master);
 
     void transmitReset();
     void transmitGiveToken(uint8_t to_addr);
@@ -72,6 +99,8 @@ private:
     void transmitAckToken(uint8_t to_addr);
 
     void transmitStart(Command_t command, uint8_t to_addr);
+    void transmitGather(Command_t command, uint8_t to_addr,
+            const HDLC_SEGMENT* seg, uint16_t count);
 
 public:
     void transmitStartWrite(uint8_t to_addr);
@@ -81,41 +110,350 @@ public:
     void transmitBlock(const void* vdata, uint16_t len);
     void transmitEnd();
 
+    void transmitGatherWrite(uint8_t to_addr, const HDLC_SEGMENT* seg, uint16_t count);
+    void transmitGatherRead(uint8_t to_addr, const HDLC_SEGMENT* seg, uint16_t count);
+
+    /* WRITE and READ frames encoded into a buffer, see HDLC_encode(). */
+    static constexpr uint32_t encodedSizeMax(uint16_t len) {
+        return HDLC_encodedSizeMax<CRC>(3U + (uint32_t)len);
+    }
+    uint32_t encodeWrite(uint8_t to_addr, const void* vdata, uint16_t len,
+            uint8_t* out, uint32_t size) const;
+    uint32_t encodeRead(uint8_t to_addr, const void* vdata, uint16_t len,
+            uint8_t* out, uint32_t size) const;
+
     uint16_t receive();
+    uint16_t receive(const void* vdata, uint16_t size, uint16_t& used);
 
     MessageHeader_t copyMessageHeader();
     uint16_t copyMessageData(uint8_t *buff, uint16_t pos, uint16_t num) const;
     uint16_t copyMessageData(uint8_t (&buff)[RXBFLEN]) const;
 
+    uint16_t getMessageData(const uint8_t*& msg) const;
+    void holdMessage();
+    void releaseMessage();
+
     void setAddress(uint8_t address) { Address = address; }
     uint8_t getAddress() const { return Address; }
+    /* Frames with a good CRC. Frames for other stations skipped unchecked
+     * with setSkipOthers() are only in getRxFilteredCount(). */
     uint16_t getRxCount() const { return RxCount; }
+    uint16_t getRxFilteredCount() const { return RxFiltered; }
     uint16_t getTxCount() const { return TxCount; }
     TokenState_t getTokenState() const { return TokenState; }
     bool haveToken() const { return TokenState == TOKEN_HAVE; }
     uint8_t getTokenAddress() const { return TokenAddress; }
 
+    using HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::getStats;
+    using HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::resetStats;
+    using HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::setEscapeMap;
+    using HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::getEscapeMap;
+
+    void setRing(const uint8_t* ring, uint8_t len) { Ring = ring; RingLen = len; }
+    void setTokenHold(uint8_t maxFrames, uint32_t maxTicks);
+    void setClock(Clock_t clock);
+    void setTokenTimeout(uint32_t passTicks, uint32_t lossTicks);
+    void setSkipOthers(bool skip);
+    uint8_t getNextStation() const { return getStationAfter(Address); }
+
+    bool queueWrite(uint8_t to_addr, const void* vdata, uint16_t len);
+    bool queueRead(uint8_t to_addr, const void* vdata, uint16_t len);
+    uint16_t getQueueFree() const { return QUEUELEN - QueueCount; }
+    void poll();
+
 private:
+    static const uint16_t QUEUELEN = (txQueueLen != 0U) ? txQueueLen : 1U;
+    static const uint8_t TOKEN_RETRIES = 3U;
+
+    uint16_t receiveFrame(uint16_t datalen);
+    bool checkOthers() const { return !SkipOthers || PassTicks != 0U; }
+    static bool acceptFrame(
+            const HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>* core,
+            const uint8_t* head);
+
+    uint8_t getStationAfter(uint8_t address) const;
+    uint8_t getRank() const;
+    void pollToken();
+
+    uint32_t encodeMessage(Command_t command, uint8_t to_addr,
+            const void* vdata, uint16_t len, uint8_t* out, uint32_t size) const;
+
+    bool queueMessage(Command_t command, uint8_t to_addr,
+            const void* vdata, uint16_t len);
+    void queuePut(const uint8_t* data, uint16_t len);
+    void queueGet(uint8_t* data, uint16_t len);
+    void transmitQueued();
+
     uint8_t Address;
+    uint16_t MessageLen;
     uint16_t RxCount;
     uint16_t TxCount;
     TokenState_t TokenState;
     uint8_t TokenAddress;
+    uint16_t RxFiltered;
+    bool SkipOthers;
+
+    const uint8_t* Ring;
+    uint8_t RingLen;
+    uint8_t HoldMaxFrames;
+    uint32_t HoldMaxTicks;
+    Clock_t Clock;
+
+    uint32_t PassTicks;
+    uint32_t LossTicks;
+    uint32_t LastFrame;
+    uint8_t PassRetries;
+
+    /* Messages: command, to, length (2 bytes, little endian), data. */
+    uint16_t QueueHead;
+    uint16_t QueueCount;
+    uint8_t Queue[QUEUELEN];
 };
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
-        HDLC_TL3B_TOKEN(uint8_t address, bool master)
+HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        HDLC_TL3B_TOKEN_CORE(const IO& io, uint8_t address, bool master):
+        HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>(io)
 {
     setAddress(address);
+    MessageLen = 0;
     RxCount = 0;
     TxCount = 0;
     TokenState = master ? TOKEN_HAVE : TOKEN_DONT_HAVE;
     TokenAddress = 0;
+    RxFiltered = 0U;
+    SkipOthers = false;
+
+    Ring = 0;
+    RingLen = 0U;
+    setClock(0);
+    setTokenHold(1U, 0U);
+    setTokenTimeout(0U, 0U);
+    PassRetries = 0U;
+    QueueHead = 0U;
+    QueueCount = 0U;
+}
+
+/* maxTicks = 0 or no clock: no time limit. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        setTokenHold(uint8_t maxFrames, uint32_t maxTicks)
+{
+    HoldMaxFrames = (maxFrames != 0U) ? maxFrames : 1U;
+    HoldMaxTicks = maxTicks;
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::setClock(Clock_t clock)
+{
+    Clock = clock;
+    LastFrame = (Clock != 0) ? Clock() : 0U;
+}
+
+/* passTicks = 0: no token recovery. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        setTokenTimeout(uint32_t passTicks, uint32_t lossTicks)
+{
+    PassTicks = passTicks;
+    LossTicks = lossTicks;
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::setReceiveFilter(
+            acceptFrame, 3U, checkOthers());
+}
+
+/* Frames for other stations are never stored. With skip they are not CRC
+ * checked either: the rest of the frame is skipped up to the next flag and
+ * only counted in getRxFilteredCount(). Token recovery needs to know that
+ * other frames are good, so it checks them anyway. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::setSkipOthers(bool skip)
+{
+    SkipOthers = skip;
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::setReceiveFilter(
+            acceptFrame, 3U, checkOthers());
+}
+
+/* The station after address in the ring, or the first one if address is not
+ * in the ring. Without a ring, this station. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint8_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        getStationAfter(uint8_t address) const
+{
+    if(RingLen == 0U)
+        return Address;
+
+    for(uint8_t i = 0U; i < RingLen; ++i)
+    {
+        if(Ring[i] == address)
+            return Ring[(i + 1U) % RingLen];
+    }
+    return Ring[0U];
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint8_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::getRank() const
+{
+    for(uint8_t i = 0U; i < RingLen; ++i)
+    {
+        if(Ring[i] == Address)
+            return i;
+    }
+    return Address;
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitReset()
+bool HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        queueWrite(uint8_t to_addr, const void* vdata, uint16_t len)
+{
+    return queueMessage(CMD_WRITE, to_addr, vdata, len);
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+bool HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        queueRead(uint8_t to_addr, const void* vdata, uint16_t len)
+{
+    return queueMessage(CMD_READ, to_addr, vdata, len);
+}
+
+/* Returns false if the message does not fit in the queue. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+bool HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        queueMessage(Command_t command, uint8_t to_addr,
+        const void* vdata, uint16_t len)
+{
+    if(txQueueLen == 0U || len + 4UL > getQueueFree())
+        return false;
+
+    const uint8_t head[4U] = {
+            (uint8_t)command, to_addr, (uint8_t)len, (uint8_t)(len >> 8U) };
+    queuePut(head, sizeof(head));
+    queuePut((const uint8_t*)vdata, len);
+    return true;
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        queuePut(const uint8_t* data, uint16_t len)
+{
+    while(len)
+    {
+        const uint16_t tail = (QueueHead + QueueCount) % QUEUELEN;
+        uint16_t num = QUEUELEN - tail;
+        if(num > len)
+            num = len;
+        memcpy(&Queue[tail], data, num);
+        QueueCount += num;
+        data += num;
+        len -= num;
+    }
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        queueGet(uint8_t* data, uint16_t len)
+{
+    while(len)
+    {
+        uint16_t num = QUEUELEN - QueueHead;
+        if(num > len)
+            num = len;
+        memcpy(data, &Queue[QueueHead], num);
+        QueueHead = (QueueHead + num) % QUEUELEN;
+        QueueCount -= num;
+        data += num;
+        len -= num;
+    }
+}
+
+/* Send the oldest queued message. The data is written straight from the
+ * queue, in at most two pieces. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitQueued()
+{
+    uint8_t head[4U];
+    queueGet(head, sizeof(head));
+    uint16_t len = head[2U] | ((uint16_t)head[3U] << 8U);
+
+    transmitStart((Command_t)head[0U], head[1U]);
+    while(len)
+    {
+        uint16_t num = QUEUELEN - QueueHead;
+        if(num > len)
+            num = len;
+        HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitBytes(&Queue[QueueHead], num);
+        QueueHead = (QueueHead + num) % QUEUELEN;
+        QueueCount -= num;
+        len -= num;
+    }
+    transmitEnd();
+}
+
+/* Retransmit an unanswered GIVE_TOKEN, or take the token on a silent bus. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::pollToken()
+{
+    const uint32_t silent = Clock() - LastFrame;
+
+    if(TokenState == TOKEN_PASSING)
+    {
+        if(silent < PassTicks)
+            return;
+
+        if(PassRetries < TOKEN_RETRIES)
+        {
+            ++PassRetries;
+            HDLC_STATS_ADD(tokenRetries, 1U);
+            transmitStart(CMD_GIVE_TOKEN, TokenAddress);
+            transmitEnd();
+        }
+        else
+        {
+            /* The station is gone. Skip it. */
+            HDLC_STATS_ADD(tokenSkips, 1U);
+            const uint8_t next = getStationAfter(TokenAddress);
+            if(next != Address)
+                transmitGiveToken(next);
+            else
+                TokenState = TOKEN_HAVE;
+        }
+    }
+    else if(TokenState == TOKEN_DONT_HAVE)
+    {
+        if(silent >= LossTicks + (uint32_t)getRank() * PassTicks)
+        {
+            HDLC_STATS_ADD(tokenRegenerations, 1U);
+            transmitReset();
+        }
+    }
+}
+
+/* Run the token scheduler: while holding the token send queued messages, then
+ * pass the token on. Does nothing without a ring. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::poll()
+{
+    if(Clock != 0 && PassTicks != 0U)
+        pollToken();
+
+    if(RingLen == 0U || TokenState != TOKEN_HAVE)
+        return;
+
+    const uint32_t start = (Clock != 0) ? Clock() : 0U;
+    for(uint8_t frames = 0U; QueueCount != 0U && frames < HoldMaxFrames; ++frames)
+    {
+        if(frames != 0U && Clock != 0 && HoldMaxTicks != 0U &&
+                Clock() - start >= HoldMaxTicks)
+            break;
+        transmitQueued();
+    }
+
+    const uint8_t next = getNextStation();
+    if(next != Address)
+        transmitGiveToken(next);
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitReset()
 {
     TokenState = TOKEN_HAVE;
     transmitStart(CMD_RESET, 0); /* broadcast */
@@ -123,7 +461,7 @@ void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitReset()
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         transmitGiveToken(uint8_t to_addr)
 {
     transmitStart(CMD_GIVE_TOKEN, to_addr);
@@ -131,10 +469,12 @@ void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
 
     TokenAddress = to_addr;
     TokenState = TOKEN_PASSING;
+    PassRetries = 0U;
+    HDLC_STATS_ADD(tokenPasses, 1U);
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         transmitAckToken(uint8_t to_addr)
 {
     transmitStart(CMD_ACK_TOKEN, to_addr);
@@ -142,60 +482,153 @@ void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         transmitStartWrite(uint8_t to_addr)
 {
     transmitStart(CMD_WRITE, to_addr);
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         transmitStartRead(uint8_t to_addr)
 {
     transmitStart(CMD_READ, to_addr);
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         transmitStart(Command_t command, uint8_t to_addr)
 {
     ++TxCount;
 
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitStart();
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(command); /* Command */
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(Address); /* From */
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(to_addr); /* To */
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitStart();
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(command); /* Command */
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(Address); /* From */
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(to_addr); /* To */
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitByte(uint8_t data)
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitByte(uint8_t data)
 {
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(data);
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitByte(data);
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         transmitBlock(const void* vdata, uint16_t len)
 {
-    const uint8_t* data = (const uint8_t*)vdata;
-    while(len)
-    {
-        transmitByte(*data);
-        ++data;
-        --len;
-    }
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitBytes(vdata, len);
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitEnd()
+{
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitEnd();
+    if(Clock != 0)
+        LastFrame = Clock();
+}
+
+/* WRITE or READ frame from several buffers, without copying them together. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        transmitGather(Command_t command, uint8_t to_addr,
+        const HDLC_SEGMENT* seg, uint16_t count)
+{
+    transmitStart(command, to_addr);
+    for(uint16_t i = 0U; i < count; ++i)
+        transmitBlock(seg[i].data, seg[i].len);
+    transmitEnd();
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        transmitGatherWrite(uint8_t to_addr, const HDLC_SEGMENT* seg, uint16_t count)
+{
+    transmitGather(CMD_WRITE, to_addr, seg, count);
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        transmitGatherRead(uint8_t to_addr, const HDLC_SEGMENT* seg, uint16_t count)
+{
+    transmitGather(CMD_READ, to_addr, seg, count);
+}
+
+/* Encoding does not touch the link: the frame is not counted and the token
+ * is not needed. Returns 0 if out is too small. */
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint32_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        encodeMessage(Command_t command, uint8_t to_addr,
+        const void* vdata, uint16_t len, uint8_t* out, uint32_t size) const
+{
+    const uint8_t head[3U] = { (uint8_t)command, Address, to_addr };
+    return HDLC_encode<CRC>(head, 3U, vdata, len, out, size,
+            HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::getEscapeMap());
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint32_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        encodeWrite(uint8_t to_addr, const void* vdata, uint16_t len,
+        uint8_t* out, uint32_t size) const
+{
+    return encodeMessage(CMD_WRITE, to_addr, vdata, len, out, size);
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint32_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        encodeRead(uint8_t to_addr, const void* vdata, uint16_t len,
+        uint8_t* out, uint32_t size) const
+{
+    return encodeMessage(CMD_READ, to_addr, vdata, len, out, size);
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-void HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::transmitEnd()
+uint16_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::receive()
 {
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::transmitEnd();
+    uint16_t datalen = HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::receive();
+    datalen = receiveFrame(datalen);
+    poll();
+    return datalen;
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-uint16_t HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::receive()
+uint16_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        receive(const void* vdata, uint16_t size, uint16_t& used)
 {
-    uint16_t datalen = HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::receive();
+    uint16_t datalen = HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::
+            receive(vdata, size, used);
+    datalen = receiveFrame(datalen);
+    poll();
+    return datalen;
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint16_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        receiveFrame(uint16_t datalen)
+{
+    const uint16_t filtered =
+            HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::getRxFilteredCount();
+    if(filtered != RxFiltered)
+    {
+        /* Frames for other stations. Skipped unchecked, they may be line
+         * noise. */
+        if(checkOthers())
+        {
+            RxCount += filtered - RxFiltered;
+            if(Clock != 0)
+                LastFrame = Clock();
+        }
+        RxFiltered = filtered;
+    }
+
+    if(datalen == 0U)
+    {
+        /* No new message. */
+        return 0U;
+    }
+
+    if(Clock != 0)
+        LastFrame = Clock();
 
     if(datalen >= 3U)
     {
@@ -204,6 +637,14 @@ uint16_t HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::receive()
 
         MessageHeader_t header = copyMessageHeader();
 
+        if(PassTicks != 0U && TokenState == TOKEN_PASSING &&
+                header.from == TokenAddress)
+        {
+            /* Token recovery: the new holder is talking, its ACK_TOKEN was
+             * lost. */
+            TokenState = TOKEN_DONT_HAVE;
+        }
+
         if(
                 (header.to == 0U || header.to == Address) &&
                 header.from != Address)
@@ -263,36 +704,109 @@ uint16_t HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::receive()
         datalen = 0U;
     }
 
+    MessageLen = datalen;
+    if(datalen != 0U)
+        HDLC_TRACE_EVENT(HDLC_TRACE_DELIVER, datalen);
     return datalen;
 }
 
+/* Receive filter: the rest of a frame is only stored if receiveFrame() would
+ * use it. */
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-typename HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::MessageHeader_t
-        HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+bool HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        acceptFrame(const HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>* core,
+        const uint8_t* head)
+{
+    const HDLC_TL3B_TOKEN_CORE* self =
+            static_cast<const HDLC_TL3B_TOKEN_CORE*>(core);
+    const uint8_t from = head[1U];
+    const uint8_t to = head[2U];
+
+    if(self->PassTicks != 0U && self->TokenState == TOKEN_PASSING &&
+            from == self->TokenAddress)
+        return true;
+    return (to == 0U || to == self->Address) && from != self->Address;
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+typename HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::MessageHeader_t
+        HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         copyMessageHeader()
 {
     uint8_t buff[3U];
-    HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::copyReceivedMessage(&buff[0U], 0U, sizeof(buff));
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::copyReceivedMessage(&buff[0U], 0U, sizeof(buff));
     MessageHeader_t header = { static_cast<Command_t>(buff[0U]), buff[1U], buff[2U] };
     return header;
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-uint16_t HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+uint16_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         copyMessageData(uint8_t *buff, uint16_t pos, uint16_t num) const
 {
-    uint16_t datalen = HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::
+    uint16_t datalen = HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::
             copyReceivedMessage(buff, pos + 3U, num);
     return datalen;
 }
 
 template<HDLC_TL3B_TOKEN_TEMPLATE>
-uint16_t HDLC_TL3B_TOKEN<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+uint16_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
         copyMessageData(uint8_t (&buff)[RXBFLEN]) const
 {
-    uint16_t datalen = HDLC<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::
+    uint16_t datalen = HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::
             copyReceivedMessage(buff, 3U, RXBFLEN);
     return datalen;
 }
 
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+uint16_t HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::
+        getMessageData(const uint8_t*& msg) const
+{
+    uint16_t datalen = HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::
+            getReceivedMessage(msg);
+    msg += 3U; /* Skip header. */
+    return (datalen != 0U) ? MessageLen : 0U;
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::holdMessage()
+{
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::holdReceivedMessage();
+}
+
+template<HDLC_TL3B_TOKEN_TEMPLATE>
+void HDLC_TL3B_TOKEN_CORE<HDLC_TL3B_TOKEN_TEMPLATETYPE>::releaseMessage()
+{
+    HDLC_CORE<HDLC_TL3B_TOKEN_BASE_TEMPLATETYPE>::releaseReceivedMessage();
+}
+
+/* HDLC_TL3B_TOKEN with I/O functions given as template arguments. */
+template<HDLC_TL3B_TOKEN_TEMPLATEDEFAULT>
+class HDLC_TL3B_TOKEN:
+        public HDLC_TL3B_TOKEN_CORE<
+                HDLC_IO_FUNC<readByte, writeByte, writeBlock>,
+                rxBuffLen, CRC, txQueueLen>
+{
+public:
+    HDLC_TL3B_TOKEN(uint8_t address, bool master = false):
+        HDLC_TL3B_TOKEN_CORE<
+                HDLC_IO_FUNC<readByte, writeByte, writeBlock>,
+                rxBuffLen, CRC, txQueueLen>(
+                        HDLC_IO_FUNC<readByte, writeByte, writeBlock>(),
+                        address, master)
+    {}
+};
+
+/* HDLC_TL3B_TOKEN with I/O bound at run time. */
+template<uint16_t rxBuffLen, class CRC, uint16_t txQueueLen = 0U>
+class HDLC_TL3B_TOKEN_PORT:
+        public HDLC_TL3B_TOKEN_CORE<HDLC_IO_PORT, rxBuffLen, CRC, txQueueLen>
+{
+public:
+    HDLC_TL3B_TOKEN_PORT(const HDLC_IO_PORT& io, uint8_t address,
+            bool master = false):
+        HDLC_TL3B_TOKEN_CORE<HDLC_IO_PORT, rxBuffLen, CRC, txQueueLen>(
+                io, address, master)
+    {}
+};
+
 #endif /* HDLC_TL3B_TOKEN_H_ */
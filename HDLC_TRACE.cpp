@@ -0,0 +1,203 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "HDLC_TRACE.h"
+
+#if HDLC_TRACE
+
+#include <stdio.h>
+
+static_assert((HDLC_TRACE_LEN & (HDLC_TRACE_LEN - 1U)) == 0U,
+        "HDLC_TRACE_LEN must be a power of two");
+
+/* Bounded ring with a sequence number per cell. A writer claims a cell by
+ * advancing head, fills it and publishes it by setting its sequence; the
+ * reader takes cells in order from tail. A cell is free for position pos
+ * when its sequence is the start of pos's lap, LAP(pos), and full when it is
+ * LAP(pos) + 1, so the zeroed ring needs no initialisation. */
+#define LAP(pos) ((pos) & ~(uint32_t)(HDLC_TRACE_LEN - 1U))
+
+struct TraceCell {
+    uint32_t seq;
+    HDLC_TRACE_RECORD record;
+};
+
+static TraceCell traceRing[HDLC_TRACE_LEN];
+static uint32_t traceHead;
+static uint32_t traceTail;
+static uint32_t traceDropped;
+static uint32_t (*traceClock)(void);
+
+void HDLC_traceSetClock(uint32_t (*clock)(void))
+{
+    __atomic_store_n(&traceClock, clock, __ATOMIC_RELEASE);
+}
+
+void HDLC_traceWrite(const void* link, uint8_t event, uint16_t arg)
+{
+    uint32_t (*clock)(void) = __atomic_load_n(&traceClock, __ATOMIC_ACQUIRE);
+    uint32_t pos = __atomic_load_n(&traceHead, __ATOMIC_RELAXED);
+    TraceCell* cell;
+    for(;;)
+    {
+        cell = &traceRing[pos & (HDLC_TRACE_LEN - 1U)];
+        const uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        const int32_t diff = (int32_t)(seq - LAP(pos));
+        if(diff == 0)
+        {
+            if(__atomic_compare_exchange_n(&traceHead, &pos, pos + 1U, true,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if(diff < 0)
+        {
+            /* Full. */
+            __atomic_fetch_add(&traceDropped, 1U, __ATOMIC_RELAXED);
+            return;
+        }
+        else
+        {
+            pos = __atomic_load_n(&traceHead, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->record.time = (clock != 0) ? clock() : 0U;
+    cell->record.link = link;
+    cell->record.arg = arg;
+    cell->record.event = event;
+    __atomic_store_n(&cell->seq, LAP(pos) + 1U, __ATOMIC_RELEASE);
+}
+
+/* Single reader. Returns false if the ring is empty. */
+bool HDLC_traceRead(HDLC_TRACE_RECORD& record)
+{
+    const uint32_t pos = traceTail;
+    TraceCell* cell = &traceRing[pos & (HDLC_TRACE_LEN - 1U)];
+    if(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != LAP(pos) + 1U)
+        return false;
+
+    record = cell->record;
+    traceTail = pos + 1U;
+    __atomic_store_n(&cell->seq, LAP(pos) + HDLC_TRACE_LEN, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t HDLC_traceDropped()
+{
+    return __atomic_load_n(&traceDropped, __ATOMIC_RELAXED);
+}
+
+#if !defined(__AVR__)
+
+static const char* const TRACENAME[] = {
+    "rx-start", "rx-end", "rx-good", "rx-bad", "deliver",
+    "tx-start", "tx-end", "ack-tx", "ack-rx"
+};
+
+/* Small link table: thread ids and open slices. */
+static const unsigned TRACELINKS = 256U;
+
+struct TraceLink {
+    const void* link;
+    bool rxOpen;
+    bool txOpen;
+    uint32_t rxStart;
+    uint32_t txStart;
+};
+
+static unsigned traceLinkId(TraceLink* links, unsigned& count, const void* link)
+{
+    for(unsigned i = 0U; i < count; ++i)
+    {
+        if(links[i].link == link)
+            return i;
+    }
+    if(count == TRACELINKS)
+        return TRACELINKS - 1U;
+    links[count].link = link;
+    links[count].rxOpen = false;
+    links[count].txOpen = false;
+    return count++;
+}
+
+static void traceSlice(FILE* f, bool& first, const char* name, unsigned tid,
+        uint32_t start, uint32_t end, uint16_t len, double ticksPerUs)
+{
+    fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"len\":%u}}",
+            first ? "" : ",", name, tid, start / ticksPerUs,
+            (uint32_t)(end - start) / ticksPerUs, (unsigned)len);
+    first = false;
+}
+
+bool HDLC_traceExportChrome(const char* path, double ticksPerUs)
+{
+    FILE* f = fopen(path, "w");
+    if(f == 0)
+        return false;
+
+    static TraceLink links[TRACELINKS];
+    unsigned count = 0U;
+    bool first = true;
+
+    fprintf(f, "{\"traceEvents\":[");
+    HDLC_TRACE_RECORD r;
+    while(HDLC_traceRead(r))
+    {
+        const unsigned tid = traceLinkId(links, count, r.link);
+        TraceLink& l = links[tid];
+        switch(r.event) {
+            case HDLC_TRACE_RX_START:
+                l.rxOpen = true;
+                l.rxStart = r.time;
+                continue;
+            case HDLC_TRACE_RX_END:
+                if(l.rxOpen)
+                    traceSlice(f, first, "rx-frame", tid, l.rxStart, r.time,
+                            r.arg, ticksPerUs);
+                l.rxOpen = false;
+                continue;
+            case HDLC_TRACE_TX_START:
+                l.txOpen = true;
+                l.txStart = r.time;
+                continue;
+            case HDLC_TRACE_TX_END:
+                if(l.txOpen)
+                    traceSlice(f, first, "tx-frame", tid, l.txStart, r.time,
+                            r.arg, ticksPerUs);
+                l.txOpen = false;
+                continue;
+            default:
+                break;
+        }
+
+        const char* name = (r.event < sizeof(TRACENAME) / sizeof(TRACENAME[0U])) ?
+                TRACENAME[r.event] : "event";
+        fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+                "\"tid\":%u,\"ts\":%.3f,\"args\":{\"arg\":%u}}",
+                first ? "" : ",", name, tid, r.time / ticksPerUs,
+                (unsigned)r.arg);
+        first = false;
+    }
+    fprintf(f, "\n],\"otherData\":{\"dropped\":%u}}\n",
+            (unsigned)HDLC_traceDropped());
+
+    return fclose(f) == 0;
+}
+
+#endif /* __AVR__ */
+
+#endif /* HDLC_TRACE */
@@ -0,0 +1,79 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef HDLC_TRACE_H_
+#define HDLC_TRACE_H_
+
+#include <stdint.h>
+
+/* Frame tracing. Build with -DHDLC_TRACE=1 (and HDLC_TRACE.cpp) to record
+ * timestamped events of every link in one ring buffer; by default the hooks
+ * are compiled out. Timestamps come from the clock given to
+ * HDLC_traceSetClock(). Any number of threads may record; one reader drains
+ * the ring with HDLC_traceRead(). When the ring is full new events are
+ * dropped and counted. */
+#ifndef HDLC_TRACE
+#define HDLC_TRACE 0
+#endif
+
+/* Ring length, a power of two. */
+#ifndef HDLC_TRACE_LEN
+#define HDLC_TRACE_LEN 4096U
+#endif
+
+enum HDLC_TraceEvent_t {
+    HDLC_TRACE_RX_START = 0,  /* First byte of a frame. arg: 0 */
+    HDLC_TRACE_RX_END,        /* Closing flag. arg: length with CRC */
+    HDLC_TRACE_RX_GOOD,       /* CRC verdict, good. arg: length */
+    HDLC_TRACE_RX_BAD,        /* CRC verdict, bad. arg: length with CRC */
+    HDLC_TRACE_DELIVER,       /* Message given to the application. arg: length */
+    HDLC_TRACE_TX_START,      /* Opening flag written. arg: 0 */
+    HDLC_TRACE_TX_END,        /* Closing flag written. arg: 0 */
+    HDLC_TRACE_ACK_TX,        /* ACK frame sent. arg: sequence */
+    HDLC_TRACE_ACK_RX         /* ACK received. arg: sequence */
+};
+
+struct HDLC_TRACE_RECORD {
+    uint32_t time;
+    const void* link;
+    uint16_t arg;
+    uint8_t event;
+};
+
+#if HDLC_TRACE
+
+#define HDLC_TRACE_EVENT(event, arg)                                           \
+        HDLC_traceWrite(this, (event), (uint16_t)(arg))
+
+void HDLC_traceSetClock(uint32_t (*clock)(void));
+void HDLC_traceWrite(const void* link, uint8_t event, uint16_t arg);
+bool HDLC_traceRead(HDLC_TRACE_RECORD& record);
+uint32_t HDLC_traceDropped();
+
+#if !defined(__AVR__)
+/* Drain the ring into a Chrome trace (chrome://tracing, Perfetto) JSON file.
+ * Frames become slices from first byte to closing flag and from opening to
+ * closing flag; other events are instants. One thread per link. */
+bool HDLC_traceExportChrome(const char* path, double ticksPerUs);
+#endif
+
+#else
+
+#define HDLC_TRACE_EVENT(event, arg) do { } while(0)
+
+#endif /* HDLC_TRACE */
+
+#endif /* HDLC_TRACE_H_ */
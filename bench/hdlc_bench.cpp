@@ -0,0 +1,308 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* Host throughput/latency benchmark for HDLC encode and decode.
+ *
+ * Usage: hdlc_bench [min_ms_per_case]
+ *
+ * For each link type, CRC, payload pattern and frame size it reports payload
+ * MB/s and ns/frame for transmitBlock() and for receive(), both the readByte()
+ * based one and the block one fed in 4 KiB chunks. */
+
+#include "HDLC.h"
+#include "HDLC_TL1B.h"
+#include "HDLC_TL3B_TOKEN.h"
+#include "CRC16_CCITT.h"
+#include "CRC32.h"
+#include "CRC32C.h"
+#include "CRC_CLMUL.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+/* Largest payload (about 64 KiB). Leaves room in the uint16_t frame length
+ * for the transport header and a 32-bit CRC. */
+static const uint16_t MAXPAYLOAD = 65024U;
+static const size_t RXSTREAMLEN = 1U << 20U;
+static const uint16_t CHUNKLEN = 4096U;
+
+static std::vector<uint8_t> wire;
+static size_t wirepos;
+
+static int16_t wireRead(void)
+{
+    if(wirepos < wire.size())
+        return wire[wirepos++];
+    return -1;
+}
+
+static void wireWrite(uint8_t data)
+{
+    wire.push_back(data);
+}
+
+static void wireWriteBlock(const uint8_t* data, uint16_t len)
+{
+    wire.insert(wire.end(), data, data + len);
+}
+
+/* Adapters giving the three link types the same transmit/receive calls. */
+
+template<class CRC>
+struct LinkHDLC {
+    typedef HDLC<wireRead, wireWrite, MAXPAYLOAD, CRC, wireWriteBlock> Link_t;
+    Link_t link;
+    static const char* name() { return "HDLC"; }
+    static const bool DELIVER = true;
+    void transmit(const uint8_t* data, uint16_t len) { link.transmitBlock(data, len); }
+    uint16_t receive() { return link.receive(); }
+    uint16_t receive(const uint8_t* data, uint16_t len, uint16_t& used) {
+        return link.receive(data, len, used);
+    }
+};
+
+/* HDLC with each deframer policy, for the byte at a time receive(). */
+template<class CRC, class Deframer>
+struct LinkHDLCDeframe {
+    typedef HDLC<wireRead, wireWrite, MAXPAYLOAD, CRC, wireWriteBlock, 1U,
+            Deframer> Link_t;
+    Link_t link;
+    static const char* name() {
+        return Deframer::TABLE ? "HDLC-table" : "HDLC-branch";
+    }
+    static const bool DELIVER = true;
+    void transmit(const uint8_t* data, uint16_t len) { link.transmitBlock(data, len); }
+    uint16_t receive() { return link.receive(); }
+    uint16_t receive(const uint8_t* data, uint16_t len, uint16_t& used) {
+        return link.receive(data, len, used);
+    }
+};
+
+template<class CRC>
+struct LinkHDLCBranch: LinkHDLCDeframe<CRC, HDLC_DEFRAME_BRANCH> {};
+
+template<class CRC>
+struct LinkHDLCTable: LinkHDLCDeframe<CRC, HDLC_DEFRAME_TABLE> {};
+
+template<class CRC>
+struct LinkTL1B {
+    typedef HDLC_TL1B<wireRead, wireWrite, MAXPAYLOAD, CRC, 63U, 5U,
+            wireWriteBlock> Link_t;
+    Link_t link;
+    static const char* name() { return "TL1B"; }
+    static const bool DELIVER = true;
+    void transmit(const uint8_t* data, uint16_t len) { link.transmitBlock(data, len); }
+    uint16_t receive() { return link.receive(); }
+    uint16_t receive(const uint8_t* data, uint16_t len, uint16_t& used) {
+        return link.receive(data, len, used);
+    }
+};
+
+/* TL3B frames from station 1 to station 2, or to station 3 (not delivered,
+ * dropped by the receive filter) with foreign = true. */
+template<class CRC, bool foreign>
+struct LinkTL3BTo {
+    typedef HDLC_TL3B_TOKEN<wireRead, wireWrite, MAXPAYLOAD, CRC,
+            wireWriteBlock> Link_t;
+    Link_t link;
+    LinkTL3BTo(): link(2U) {}
+    static const char* name() { return foreign ? "TL3B-other" : "TL3B"; }
+    static const bool DELIVER = !foreign;
+    void transmit(const uint8_t* data, uint16_t len) {
+        link.setAddress(1U);
+        link.transmitStartWrite(foreign ? 3U : 2U);
+        link.transmitBlock(data, len);
+        link.transmitEnd();
+        link.setAddress(2U);
+    }
+    uint16_t receive() { return link.receive(); }
+    uint16_t receive(const uint8_t* data, uint16_t len, uint16_t& used) {
+        return link.receive(data, len, used);
+    }
+};
+
+template<class CRC>
+struct LinkTL3B: LinkTL3BTo<CRC, false> {};
+
+template<class CRC>
+struct LinkTL3BOther: LinkTL3BTo<CRC, true> {};
+
+enum Pattern_t {
+    PATTERN_CLEAN = 0,
+    PATTERN_RANDOM,
+    PATTERN_ESCAPE
+};
+
+static const char* const PATTERNNAME[] = { "clean", "random", "all-~" };
+
+static void fillPayload(std::vector<uint8_t>& payload, Pattern_t pattern)
+{
+    for(size_t i = 0U; i < payload.size(); ++i)
+    {
+        uint8_t c;
+        switch(pattern) {
+            case PATTERN_CLEAN:
+                c = (uint8_t)(i % 0x7DU);
+                break;
+            case PATTERN_RANDOM:
+                c = (uint8_t)rand();
+                break;
+            default:
+                c = '~';
+                break;
+        }
+        payload[i] = c;
+    }
+}
+
+typedef std::chrono::steady_clock Clock_t;
+
+static double elapsedNs(Clock_t::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock_t::now() - start).count();
+}
+
+static double minNs;
+
+static void report(const char* link, const char* crc, const char* op,
+        Pattern_t pattern, uint16_t size, double ns, size_t frames)
+{
+    const double nsFrame = ns / frames;
+    const double mbs = (double)size * frames / (ns / 1e9) / 1e6;
+    printf("%-11s %-18s %-9s %-7s %6u B %10.1f MB/s %12.1f ns/frame\n",
+            link, crc, op, PATTERNNAME[pattern], size, mbs, nsFrame);
+}
+
+template<class L>
+static void benchCase(const char* crcname, Pattern_t pattern, uint16_t size)
+{
+    static L tx;
+    static L rx;
+    std::vector<uint8_t> payload(size);
+    fillPayload(payload, pattern);
+
+    /* Transmit. */
+    {
+        size_t frames = 0U;
+        double ns = 0.0;
+        const Clock_t::time_point start = Clock_t::now();
+        do {
+            for(uint8_t i = 0U; i < 16U; ++i)
+            {
+                wire.clear();
+                tx.transmit(&payload[0U], size);
+            }
+            frames += 16U;
+            ns = elapsedNs(start);
+        } while(ns < minNs);
+        report(L::name(), crcname, "tx", pattern, size, ns, frames);
+    }
+
+    /* Encoded stream of back-to-back frames for the receive cases. */
+    wire.clear();
+    size_t streamFrames = 0U;
+    do {
+        tx.transmit(&payload[0U], size);
+        ++streamFrames;
+    } while(wire.size() < RXSTREAMLEN);
+    const std::vector<uint8_t> stream(wire);
+
+    /* Receive, one readByte() per call. */
+    {
+        size_t frames = 0U;
+        double ns = 0.0;
+        const Clock_t::time_point start = Clock_t::now();
+        do {
+            wire = stream;
+            wirepos = 0U;
+            while(wirepos < stream.size())
+                rx.receive();
+            frames += streamFrames;
+            ns = elapsedNs(start);
+        } while(ns < minNs);
+        report(L::name(), crcname, "rx-byte", pattern, size, ns, frames);
+    }
+
+    /* Receive, block API fed in CHUNKLEN chunks. */
+    {
+        size_t frames = 0U;
+        size_t good = 0U;
+        double ns = 0.0;
+        const Clock_t::time_point start = Clock_t::now();
+        do {
+            wire.clear();
+            size_t pos = 0U;
+            while(pos < stream.size())
+            {
+                uint16_t len = (stream.size() - pos > CHUNKLEN) ?
+                        CHUNKLEN : (uint16_t)(stream.size() - pos);
+                const uint8_t* data = &stream[pos];
+                pos += len;
+                while(len)
+                {
+                    uint16_t used;
+                    if(rx.receive(data, len, used) != 0U)
+                        ++good;
+                    data += used;
+                    len -= used;
+                }
+            }
+            frames += streamFrames;
+            ns = elapsedNs(start);
+        } while(ns < minNs);
+        report(L::name(), crcname, "rx-block", pattern, size, ns, frames);
+        if(good == 0U && L::DELIVER)
+            printf("warning: no good frames decoded\n");
+    }
+}
+
+static const uint16_t SIZES[] = { 4U, 16U, 64U, 256U, 1024U, 4096U, 16384U, MAXPAYLOAD };
+
+template<template<class> class L, class CRC>
+static void benchLink(const char* crcname)
+{
+    for(uint8_t p = PATTERN_CLEAN; p <= PATTERN_ESCAPE; ++p)
+        for(size_t s = 0U; s < sizeof(SIZES) / sizeof(SIZES[0U]); ++s)
+            benchCase<L<CRC> >(crcname, (Pattern_t)p, SIZES[s]);
+}
+
+template<template<class> class L>
+static void benchAllCRC()
+{
+    benchLink<L, CRC16_CCITT>("CRC16_CCITT");
+    benchLink<L, CRC16_CCITT_CLMUL>("CRC16_CCITT_CLMUL");
+    benchLink<L, CRC32>("CRC32");
+    benchLink<L, CRC32_CLMUL>("CRC32_CLMUL");
+    benchLink<L, CRC32C>("CRC32C");
+}
+
+int main(int argc, char* argv[])
+{
+    minNs = 1e6 * ((argc > 1) ? atof(argv[1]) : 50.0);
+    wire.reserve(2U * RXSTREAMLEN + 4U * MAXPAYLOAD);
+
+    benchAllCRC<LinkHDLC>();
+    benchLink<LinkHDLCBranch, CRC16_CCITT>("CRC16_CCITT");
+    benchLink<LinkHDLCTable, CRC16_CCITT>("CRC16_CCITT");
+    benchAllCRC<LinkTL1B>();
+    benchAllCRC<LinkTL3B>();
+    benchLink<LinkTL3BOther, CRC16_CCITT>("CRC16_CCITT");
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* Many links driven by HDLC_LINK_MANAGER over socketpairs and ptys.
+ *
+ * Usage: hdlc_links [links] [frames_per_link] [shards]
+ *
+ * A writer thread sends frames on the far end of every link; the manager (or
+ * the shards, if shards > 0) receives them. Every frame is checked and the
+ * received frames/s and payload MB/s are reported. */
+
+#include "HDLC_LINK_MANAGER.h"
+#include "CRC16_CCITT.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <chrono>
+#include <vector>
+
+static const uint16_t PAYLOAD = 64U;
+
+typedef HDLC_FD<PAYLOAD, CRC16_CCITT> Link_t;
+
+struct Counter {
+    std::atomic<uint32_t> good;
+    std::atomic<uint32_t> bad;
+};
+
+static void onMessage(void* ctx, HDLC_LINK& link, const uint8_t* msg, uint16_t len)
+{
+    Counter* counter = (Counter*)ctx;
+    const uint8_t id = (uint8_t)link.getFd();
+    if(len == PAYLOAD && msg[0U] == id && msg[PAYLOAD - 1U] == (uint8_t)~id)
+        ++counter->good;
+    else
+        ++counter->bad;
+}
+
+/* Far end of a pty pair in raw mode, so bytes pass unchanged. */
+static bool openPty(int fds[2])
+{
+    fds[0] = posix_openpt(O_RDWR | O_NOCTTY);
+    if(fds[0] < 0 || grantpt(fds[0]) < 0 || unlockpt(fds[0]) < 0)
+        return false;
+    fds[1] = open(ptsname(fds[0]), O_RDWR | O_NOCTTY);
+    if(fds[1] < 0)
+        return false;
+    struct termios tio;
+    tcgetattr(fds[1], &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fds[1], TCSANOW, &tio);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned nlinks = (argc > 1) ? atoi(argv[1]) : 256U;
+    const unsigned nframes = (argc > 2) ? atoi(argv[2]) : 2000U;
+    const unsigned nshards = (argc > 3) ? atoi(argv[3]) : 0U;
+
+    Counter counter;
+    counter.good = 0U;
+    counter.bad = 0U;
+
+    /* Every eighth link is a pty, the others are socketpairs. */
+    std::vector<Link_t*> rx;
+    std::vector<Link_t*> tx;
+    for(unsigned i = 0U; i < nlinks; ++i)
+    {
+        int fds[2];
+        bool ok = (i % 8U == 7U) ? openPty(fds) :
+                (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        if(!ok)
+        {
+            perror("link");
+            return 1;
+        }
+        rx.push_back(new Link_t(fds[0]));
+        tx.push_back(new Link_t(fds[1]));
+        rx.back()->setHandler(onMessage, &counter);
+    }
+
+    HDLC_LINK_MANAGER manager;
+    HDLC_LINK_SHARDS shards((nshards != 0U) ? nshards : 1U);
+    for(unsigned i = 0U; i < nlinks; ++i)
+    {
+        if(nshards != 0U)
+            shards.add(*rx[i]);
+        else
+            manager.add(*rx[i]);
+    }
+
+    const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+
+    std::thread writer([&]() {
+        uint8_t payload[PAYLOAD];
+        for(unsigned f = 0U; f < nframes; ++f)
+        {
+            for(unsigned i = 0U; i < nlinks; ++i)
+            {
+                const uint8_t id = (uint8_t)rx[i]->getFd();
+                memset(payload, (uint8_t)f, sizeof(payload));
+                payload[0U] = id;
+                payload[PAYLOAD - 1U] = (uint8_t)~id;
+                tx[i]->transmitBlock(payload, sizeof(payload));
+            }
+        }
+    });
+
+    const uint32_t total = nlinks * nframes;
+    if(nshards != 0U)
+    {
+        shards.start();
+        while(counter.good + counter.bad < total)
+            usleep(1000U);
+        shards.stop();
+    }
+    else
+    {
+        while(counter.good + counter.bad < total)
+            manager.poll(100);
+    }
+    writer.join();
+
+    const double s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    printf("%u links %u shards: %u good %u bad frames, %.0f frames/s, "
+            "%.1f MB/s\n", nlinks, nshards, (unsigned)counter.good,
+            (unsigned)counter.bad, total / s, total * (double)PAYLOAD / s / 1e6);
+
+    for(unsigned i = 0U; i < nlinks; ++i)
+    {
+        close(rx[i]->getFd());
+        close(tx[i]->getFd());
+        delete rx[i];
+        delete tx[i];
+    }
+    return (counter.bad == 0U) ? 0 : 1;
+}
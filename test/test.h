@@ -0,0 +1,110 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef HDLC_TEST_H_
+#define HDLC_TEST_H_
+
+/* Helpers for the regression tests: CHECK() reports and counts failures,
+ * TEST_WIRE records what a link writes so a test can deliver, drop or
+ * reorder whole frames, and testClock() is a clock the test moves by hand. */
+
+#include "HDLC.h"
+
+#include <stdio.h>
+#include <vector>
+
+static int testFailures = 0;
+
+#define CHECK(cond)                                                            \
+        do {                                                                   \
+            if(!(cond))                                                        \
+            {                                                                  \
+                ++testFailures;                                                \
+                fprintf(stderr, "%s:%d: CHECK(%s) failed\n",                   \
+                        __FILE__, __LINE__, #cond);                            \
+            }                                                                  \
+        } while(0)
+
+static inline int testResult(const char* name)
+{
+    if(testFailures != 0)
+        fprintf(stderr, "%s: %d failed\n", name, testFailures);
+    else
+        printf("%s: ok\n", name);
+    return (testFailures != 0) ? 1 : 0;
+}
+
+static uint32_t testNow = 0U;
+
+static inline uint32_t testClock()
+{
+    return testNow;
+}
+
+typedef std::vector<uint8_t> TEST_FRAME;
+
+/* Output of a link, and bytes waiting to be read by it. */
+struct TEST_WIRE {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> in;
+    size_t inPos;
+
+    TEST_WIRE(): inPos(0U) {}
+
+    HDLC_IO_PORT io() { return HDLC_IO_PORT(this, read, write); }
+
+    static int16_t read(void* ctx) {
+        TEST_WIRE* w = (TEST_WIRE*)ctx;
+        if(w->inPos == w->in.size())
+            return -1;
+        return w->in[w->inPos++];
+    }
+
+    static void write(void* ctx, uint8_t data) {
+        ((TEST_WIRE*)ctx)->out.push_back(data);
+    }
+
+    /* Take the written frames, flags removed. */
+    std::vector<TEST_FRAME> frames() {
+        std::vector<TEST_FRAME> list;
+        TEST_FRAME frame;
+        for(size_t i = 0U; i < out.size(); ++i)
+        {
+            if(out[i] != '~')
+            {
+                frame.push_back(out[i]);
+            }
+            else if(!frame.empty())
+            {
+                list.push_back(frame);
+                frame.clear();
+            }
+        }
+        out.clear();
+        return list;
+    }
+
+    /* Queue a frame to be read, flags added. */
+    void put(const TEST_FRAME& frame) {
+        in.push_back('~');
+        in.insert(in.end(), frame.begin(), frame.end());
+        in.push_back('~');
+    }
+
+    bool empty() const { return inPos == in.size(); }
+};
+
+#endif /* HDLC_TEST_H_ */
@@ -0,0 +1,138 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* CRC: check values, and the PCLMULQDQ and SSE4.2 block updates against the
+ * table CRC over every length, alignment and split of a block. */
+
+#include "test.h"
+#include "CRC16_CCITT.h"
+#include "CRC32.h"
+#include "CRC32C.h"
+#include "CRC_CLMUL.h"
+
+static uint32_t testRandom = 1U;
+
+static uint8_t randomByte()
+{
+    testRandom = testRandom * 1103515245U + 12345U;
+    return (uint8_t)(testRandom >> 16U);
+}
+
+/* CRC of "123456789", and the good frame residue once the CRC is appended. */
+template<class CRC_t>
+static void testCheck(uint32_t check)
+{
+    static const char digits[] = "123456789";
+    uint8_t frame[9U + 4U];
+    memcpy(frame, digits, 9U);
+
+    CRC_t crc;
+    crc.init();
+    crc.update(frame, 9U);
+    crc.final();
+    CHECK(crc.crc == check);
+
+    for(int8_t i = 0; i < crc.size; ++i)
+        frame[9U + i] = crc[i];
+    crc.init();
+    crc.update(frame, 9U + crc.size);
+    CHECK(crc.good());
+
+    crc.init();
+    for(uint8_t i = 0U; i < 9U; ++i)
+        crc.update(frame[i]);
+    crc.final();
+    CHECK(crc.crc == check);
+}
+
+/* Fast gives the same CRC as Table for lengths 0 to 600 (tails of 0 to 63
+ * bytes after the 64-byte blocks, under 16 included), at every alignment up
+ * to 16 and with the block split in two updates, so that a block starts
+ * from any register value. */
+template<class Fast, class Table>
+static void testBlock()
+{
+    uint8_t buff[600U + 16U];
+    for(size_t i = 0U; i < sizeof(buff); ++i)
+        buff[i] = randomByte();
+
+    for(size_t len = 0U; len <= 600U; ++len)
+    {
+        const size_t offset = randomByte() % 16U;
+        const size_t split = (len != 0U) ? randomByte() % len : 0U;
+        const uint8_t* data = &buff[offset];
+
+        Table table;
+        table.init();
+        for(size_t i = 0U; i < len; ++i)
+            table.update(data[i]);
+
+        Fast whole;
+        whole.init();
+        whole.update(data, len);
+        CHECK(whole.crc == table.crc);
+
+        Fast parts;
+        parts.init();
+        parts.update(data, split);
+        parts.update(&data[split], len - split);
+        CHECK(parts.crc == table.crc);
+
+        Table slices;
+        slices.init();
+        slices.update(data, len);
+        CHECK(slices.crc == table.crc);
+
+        if(whole.crc != table.crc || parts.crc != table.crc)
+            return;
+    }
+}
+
+int main()
+{
+    testCheck<CRC16_CCITT>(0x906EU);
+    testCheck<CRC32>(0xCBF43926UL);
+    testCheck<CRC32C_TABLE>(0xE3069283UL);
+    testCheck<CRC16_CCITT_CLMUL>(0x906EU);
+    testCheck<CRC32_CLMUL>(0xCBF43926UL);
+    testCheck<CRC32C>(0xE3069283UL);
+
+    testBlock<CRC16_CCITT_CLMUL, CRC16_CCITT>();
+    testBlock<CRC32_CLMUL, CRC32>();
+    testBlock<CRC32C, CRC32C_TABLE>();
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    if(!__builtin_cpu_supports("pclmul"))
+        printf("test_crc: no PCLMULQDQ, folding not tested\n");
+    if(!__builtin_cpu_supports("sse4.2"))
+        printf("test_crc: no SSE4.2, crc32 instruction not tested\n");
+#endif
+
+    /* A long run, many blocks folded with the 512-bit constants. */
+    uint8_t big[4096U + 7U];
+    for(size_t i = 0U; i < sizeof(big); ++i)
+        big[i] = randomByte();
+    CRC32_CLMUL fast;
+    CRC32 table;
+    fast.init();
+    table.init();
+    fast.update(big, sizeof(big));
+    for(size_t i = 0U; i < sizeof(big); ++i)
+        table.update(big[i]);
+    CHECK(fast.crc == table.crc);
+
+    return testResult("test_crc");
+}
@@ -0,0 +1,318 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC: receive queue, deframers and escape maps. */
+
+#include "test.h"
+#include "CRC16_CCITT.h"
+
+/* Encode a frame of len bytes of value c. */
+static TEST_FRAME encodeFrame(uint8_t c, uint16_t len)
+{
+    std::vector<uint8_t> data(len, c);
+    TEST_FRAME frame(HDLC_encodedSizeMax<CRC16_CCITT>(len));
+    frame.resize(HDLC_encode<CRC16_CCITT>(data.data(), len,
+            frame.data(), frame.size()));
+    return frame;
+}
+
+/* A frame whose opening flag arrives while the queue is full is received
+ * once a slot is released before its first byte. */
+template<class Deframer>
+static void testReleaseFull(bool block)
+{
+    TEST_WIRE wire;
+    HDLC_PORT<16U, CRC16_CCITT, 2U, Deframer> link(wire.io());
+
+    const TEST_FRAME a = encodeFrame('a', 4U);
+    const TEST_FRAME b = encodeFrame('b', 4U);
+    const TEST_FRAME c = encodeFrame('c', 4U);
+
+    TEST_FRAME head(a);
+    head.insert(head.end(), b.begin(), b.end());
+    head.push_back('~');
+    const TEST_FRAME tail(c.begin() + 1, c.end());
+
+    uint16_t used;
+    if(block)
+    {
+        for(size_t pos = 0U; pos < head.size(); pos += used)
+            link.receive(&head[pos], head.size() - pos, used);
+    }
+    else
+    {
+        wire.in = head;
+        while(!wire.empty())
+            link.receive();
+    }
+    CHECK(link.getReceivedMessageCount() == 2U);
+
+    link.releaseReceivedMessage();
+    link.releaseReceivedMessage();
+
+    uint16_t datalen = 0U;
+    if(block)
+    {
+        for(size_t pos = 0U; pos < tail.size(); pos += used)
+            datalen = link.receive(&tail[pos], tail.size() - pos, used);
+    }
+    else
+    {
+        wire.in.insert(wire.in.end(), tail.begin(), tail.end());
+        while(!wire.empty())
+            datalen = link.receive();
+    }
+
+    const uint8_t* msg;
+    CHECK(datalen == 4U);
+    CHECK(link.getReceivedMessageCount() == 1U);
+    CHECK(link.getReceivedMessage(msg) == 4U && msg[0U] == 'c');
+    CHECK(link.getRxOverflowCount() == 0U);
+}
+
+/* copyReceivedMessage() copies the oldest queued frame, also while the next
+ * one is being received. */
+static void testCopyQueued()
+{
+    TEST_WIRE wire;
+    HDLC_PORT<16U, CRC16_CCITT, 3U> link(wire.io());
+
+    const TEST_FRAME a = encodeFrame('a', 3U);
+    const TEST_FRAME b = encodeFrame('b', 5U);
+    const TEST_FRAME c = encodeFrame('c', 7U);
+    wire.in = a;
+    wire.in.insert(wire.in.end(), b.begin(), b.end());
+    wire.in.insert(wire.in.end(), c.begin(), c.end() - 4);
+    while(!wire.empty())
+        link.receive();
+    CHECK(link.getReceivedMessageCount() == 2U);
+
+    uint8_t buff[16U];
+    uint8_t part[4U];
+    CHECK(link.copyReceivedMessage(buff) == 3U);
+    CHECK(buff[0U] == 'a' && buff[2U] == 'a');
+    CHECK(link.copyReceivedMessage(part, 1U, 4U) == 2U && part[1U] == 'a');
+    CHECK(link.copyReceivedMessage(part, 3U, 4U) == 0U);
+
+    link.releaseReceivedMessage();
+    CHECK(link.copyReceivedMessage(buff) == 5U);
+    CHECK(buff[0U] == 'b' && buff[4U] == 'b');
+
+    wire.in.insert(wire.in.end(), c.end() - 4, c.end());
+    while(!wire.empty())
+        link.receive();
+    CHECK(link.copyReceivedMessage(buff) == 5U && buff[0U] == 'b');
+    link.releaseReceivedMessage();
+    CHECK(link.copyReceivedMessage(buff) == 7U);
+    CHECK(buff[0U] == 'c' && buff[6U] == 'c');
+    link.releaseReceivedMessage();
+    CHECK(link.copyReceivedMessage(buff) == 0U);
+}
+
+static uint32_t testRandom = 1U;
+
+static uint8_t randomByte()
+{
+    testRandom = testRandom * 1103515245U + 12345U;
+    return (uint8_t)(testRandom >> 16U);
+}
+
+/* A line of good frames, payloads full of flags and escapes, damaged and
+ * oversize frames, aborts, empty frames and noise. */
+static TEST_FRAME randomLine(size_t segments)
+{
+    static const uint8_t special[4U] = { '~', '}', 0x5EU, 0x5DU };
+    TEST_FRAME line;
+    for(size_t n = 0U; n < segments; ++n)
+    {
+        const uint8_t kind = randomByte() % 6U;
+        if(kind <= 2U)
+        {
+            /* Good frame, damaged if kind is 2. Up to 40 bytes, some too long
+             * for the buffer. */
+            std::vector<uint8_t> data(randomByte() % 41U);
+            for(size_t i = 0U; i < data.size(); ++i)
+                data[i] = (randomByte() & 1U) ? special[randomByte() % 4U] : randomByte();
+            TEST_FRAME frame(HDLC_encodedSizeMax<CRC16_CCITT>(data.size()));
+            frame.resize(HDLC_encode<CRC16_CCITT>(data.data(), data.size(),
+                    frame.data(), frame.size()));
+            if(kind == 2U && frame.size() > 2U)
+                frame[1U + randomByte() % (frame.size() - 2U)] ^= 0x01U;
+            line.insert(line.end(), frame.begin(), frame.end());
+        }
+        else if(kind == 3U)
+        {
+            /* Abort sequence, or a frame cut by one. */
+            line.push_back('}');
+            line.push_back('~');
+        }
+        else if(kind == 4U)
+        {
+            line.push_back('~');
+            line.push_back('~');
+        }
+        else
+        {
+            for(uint8_t i = randomByte() % 8U; i != 0U; --i)
+                line.push_back((randomByte() & 1U) ? special[randomByte() % 4U] : randomByte());
+        }
+    }
+    return line;
+}
+
+/* Receive a line a byte at a time, or as one block. Returns the messages. */
+template<class Link_t>
+static std::vector<TEST_FRAME> receiveLine(Link_t& link, TEST_WIRE& wire,
+        const TEST_FRAME& line, bool block)
+{
+    std::vector<TEST_FRAME> msgs;
+    const uint8_t* msg;
+    if(block)
+    {
+        uint16_t used;
+        for(size_t pos = 0U; pos < line.size(); pos += used)
+        {
+            const uint16_t size = (line.size() - pos > 0xFFFFU) ?
+                    0xFFFFU : (uint16_t)(line.size() - pos);
+            const uint16_t len = link.receive(&line[pos], size, used);
+            if(len != 0U && link.getReceivedMessage(msg) == len)
+                msgs.push_back(TEST_FRAME(msg, msg + len));
+            link.releaseReceivedMessage();
+        }
+    }
+    else
+    {
+        wire.in = line;
+        while(!wire.empty())
+        {
+            const uint16_t len = link.receive();
+            if(len != 0U && link.getReceivedMessage(msg) == len)
+                msgs.push_back(TEST_FRAME(msg, msg + len));
+            link.releaseReceivedMessage();
+        }
+    }
+    return msgs;
+}
+
+/* The table deframer, the branch deframer and the block receive() take the
+ * same frames out of the same line, and count the same errors. */
+static void testDeframers()
+{
+    for(uint32_t seed = 1U; seed <= 20U; ++seed)
+    {
+        testRandom = seed;
+        const TEST_FRAME line = randomLine(200U);
+
+        TEST_WIRE wb;
+        TEST_WIRE wt;
+        TEST_WIRE wk;
+        HDLC_PORT<32U, CRC16_CCITT, 1U, HDLC_DEFRAME_BRANCH> branch(wb.io());
+        HDLC_PORT<32U, CRC16_CCITT, 1U, HDLC_DEFRAME_TABLE> table(wt.io());
+        HDLC_PORT<32U, CRC16_CCITT, 1U, HDLC_DEFRAME_BRANCH> block(wk.io());
+
+        const std::vector<TEST_FRAME> mb = receiveLine(branch, wb, line, false);
+        const std::vector<TEST_FRAME> mt = receiveLine(table, wt, line, false);
+        const std::vector<TEST_FRAME> mk = receiveLine(block, wk, line, true);
+
+        CHECK(mb.size() > 20U);
+        CHECK(mt == mb);
+        CHECK(mk == mb);
+        CHECK(table.getRxOversizeCount() == branch.getRxOversizeCount());
+        CHECK(block.getRxOversizeCount() == branch.getRxOversizeCount());
+        CHECK(branch.getRxOversizeCount() != 0U);
+    }
+}
+
+/* Round trip with a map of all control characters and high bytes, some of
+ * them the escaped form of others (0x91 and 0xB1, '}' and 0x5D). Map bytes
+ * inserted by the line are dropped; escaped ones are data. */
+static void testEscapeMap()
+{
+    static const uint8_t high[6U] = { 0x91U, 0xB1U, 0x5DU, 0x80U, 0xA0U, 0xFFU };
+    uint8_t map[HDLC_ESCAPEMAPLEN];
+    HDLC_escapeMapInit(map, 0xFFFFFFFFUL);
+    for(uint8_t i = 0U; i < 6U; ++i)
+        CHECK(HDLC_escapeMapAdd(map, high[i]));
+    CHECK(!HDLC_escapeMapAdd(map, 0x5EU));
+    CHECK(!HDLC_escapeMapTest(map, 0x5EU));
+
+    TEST_WIRE wire;
+    HDLC_PORT<64U, CRC16_CCITT> sender(wire.io());
+    sender.setEscapeMap(map);
+
+    testRandom = 7U;
+    std::vector<TEST_FRAME> sent;
+    TEST_FRAME line;
+    for(uint16_t n = 0U; n < 200U; ++n)
+    {
+        TEST_FRAME data(1U + randomByte() % 40U);
+        for(size_t i = 0U; i < data.size(); ++i)
+            data[i] = (randomByte() & 1U) ? high[randomByte() % 6U] : randomByte();
+        sent.push_back(data);
+
+        sender.transmitBlock(data.data(), data.size());
+        TEST_FRAME frame(sender.encodedSizeMax(data.size()));
+        frame.resize(sender.encode(data.data(), data.size(),
+                frame.data(), frame.size()));
+        CHECK(frame == wire.out);
+
+        /* Escaped bytes never appear unescaped on the line. */
+        for(size_t i = 1U; i + 1U < frame.size(); ++i)
+        {
+            CHECK(frame[i] != '~');
+            CHECK(frame[i - 1U] == '}' || frame[i] == '}' ||
+                    !HDLC_escapeMapTest(map, frame[i]));
+        }
+
+        /* XON and XOFF from the line, outside of an escape. */
+        for(size_t i = 0U; i < wire.out.size(); ++i)
+        {
+            line.push_back(wire.out[i]);
+            if(wire.out[i] != '}' && randomByte() % 8U == 0U)
+                line.push_back((randomByte() & 1U) ? 0x11U : 0x13U);
+        }
+        wire.out.clear();
+    }
+
+    TEST_WIRE wb;
+    TEST_WIRE wt;
+    TEST_WIRE wk;
+    TEST_WIRE wl;
+    HDLC_PORT<64U, CRC16_CCITT, 1U, HDLC_DEFRAME_BRANCH> branch(wb.io());
+    HDLC_PORT<64U, CRC16_CCITT, 1U, HDLC_DEFRAME_TABLE> table(wt.io());
+    HDLC_PORT<64U, CRC16_CCITT, 1U, HDLC_DEFRAME_BRANCH> block(wk.io());
+    HDLC_PORT<64U, CRC16_CCITT, 1U, HDLC_DEFRAME_TABLE> blockTable(wl.io());
+    branch.setEscapeMap(map);
+    table.setEscapeMap(map);
+    block.setEscapeMap(map);
+    blockTable.setEscapeMap(map);
+
+    CHECK(receiveLine(branch, wb, line, false) == sent);
+    CHECK(receiveLine(table, wt, line, false) == sent);
+    CHECK(receiveLine(block, wk, line, true) == sent);
+    CHECK(receiveLine(blockTable, wl, line, true) == sent);
+}
+
+int main()
+{
+    testReleaseFull<HDLC_DEFRAME_BRANCH>(false);
+    testReleaseFull<HDLC_DEFRAME_TABLE>(false);
+    testReleaseFull<HDLC_DEFRAME_BRANCH>(true);
+    testCopyQueued();
+    testDeframers();
+    testEscapeMap();
+    return testResult("test_hdlc");
+}
@@ -0,0 +1,171 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC_LINK_MANAGER: held messages, output to a slow reader and timers on a
+ * silent line. */
+
+#include "test.h"
+#include "HDLC_LINK_MANAGER.h"
+#include "CRC16_CCITT.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* Messages seen by the handler. The first one is held if hold is set. */
+struct TEST_SINK {
+    std::vector<TEST_FRAME> msgs;
+    bool hold;
+};
+
+static void onMessage(void* ctx, HDLC_LINK& link, const uint8_t* msg, uint16_t len)
+{
+    TEST_SINK* sink = (TEST_SINK*)ctx;
+    sink->msgs.push_back(TEST_FRAME(msg, msg + len));
+    if(sink->hold)
+    {
+        sink->hold = false;
+        link.hold();
+    }
+}
+
+/* Several frames arrive in one read and the handler holds the first. The
+ * others are received after it is released. */
+template<class Link_t, class Sender_t>
+static void testHold()
+{
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    Link_t link(fds[0]);
+    TEST_SINK sink;
+    sink.hold = true;
+    link.setHandler(onMessage, &sink);
+
+    HDLC_LINK_MANAGER manager;
+    CHECK(manager.add(link));
+
+    TEST_WIRE wire;
+    Sender_t sender(wire.io());
+    for(uint8_t n = 0U; n < 3U; ++n)
+    {
+        const TEST_FRAME msg(4U, 'a' + n);
+        sender.transmitBlock(msg.data(), msg.size());
+    }
+    CHECK(write(fds[1], wire.out.data(), wire.out.size()) == (ssize_t)wire.out.size());
+
+    manager.poll(1000);
+    manager.poll(0);
+    CHECK(sink.msgs.size() == 1U);
+    CHECK(link.isHeld());
+    CHECK(sink.msgs[0U] == TEST_FRAME(4U, 'a'));
+
+    link.release();
+    manager.poll(0);
+    CHECK(sink.msgs.size() == 3U);
+    CHECK(sink.msgs.back() == TEST_FRAME(4U, 'c'));
+
+    manager.remove(link);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/* Output the peer does not read yet is kept, and poll() does not block on
+ * it. It is all written once the peer reads. */
+static void testSlowReader()
+{
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    int size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    HDLC_FD<64U, CRC16_CCITT> link(fds[0]);
+    HDLC_LINK_MANAGER manager;
+    CHECK(manager.add(link));
+
+    TEST_WIRE wire;
+    HDLC_PORT<64U, CRC16_CCITT> expected(wire.io());
+    for(uint16_t n = 0U; n < 500U; ++n)
+    {
+        const TEST_FRAME msg(64U, (uint8_t)n);
+        link.transmitBlock(msg.data(), msg.size());
+        expected.transmitBlock(msg.data(), msg.size());
+    }
+    CHECK(manager.poll(0) == 0);
+
+    TEST_FRAME got;
+    for(int i = 0; i < 1000 && got.size() < wire.out.size(); ++i)
+    {
+        uint8_t buff[4096];
+        const ssize_t n = read(fds[1], buff, sizeof(buff));
+        if(n > 0)
+            got.insert(got.end(), buff, buff + n);
+        manager.poll(10);
+    }
+    CHECK(got == wire.out);
+
+    manager.remove(link);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/* A lost frame is retransmitted by the manager's tick while nothing is
+ * received. */
+static void testTick()
+{
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    HDLC_TL1B_FD<16U, CRC16_CCITT, 63U, 5U, 4U> link(fds[0]);
+    link.setClock(testClock);
+    link.setRetransmitTimeout(100U, 10U, 1000U);
+    HDLC_LINK_MANAGER manager;
+    manager.setTick(1);
+    CHECK(manager.add(link));
+
+    const TEST_FRAME msg(8U, 'x');
+    CHECK(link.transmitBlock(msg.data(), msg.size()));
+
+    uint8_t buff[256];
+    const ssize_t len = read(fds[1], buff, sizeof(buff));
+    CHECK(len > 0);
+
+    manager.poll(10);
+    CHECK(read(fds[1], buff, sizeof(buff)) < 0);
+
+    testNow += 200U;
+    manager.poll(10);
+    manager.poll(10);
+    CHECK(read(fds[1], buff, sizeof(buff)) == len);
+
+    manager.remove(link);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main()
+{
+    testHold<HDLC_FD<16U, CRC16_CCITT>, HDLC_PORT<16U, CRC16_CCITT> >();
+    testHold<HDLC_FD<16U, CRC16_CCITT, 2U>, HDLC_PORT<16U, CRC16_CCITT> >();
+    testHold<HDLC_TL1B_FD<16U, CRC16_CCITT>, HDLC_TL1B_PORT<16U, CRC16_CCITT> >();
+    testHold<HDLC_TL1B_FD<16U, CRC16_CCITT, 63U, 5U, 4U>,
+            HDLC_TL1B_PORT<16U, CRC16_CCITT, 63U, 5U, 4U> >();
+    testSlowReader();
+    testTick();
+    return testResult("test_link_manager");
+}
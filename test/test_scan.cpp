@@ -0,0 +1,162 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC_SCAN: every vector search the CPU can run gives the same result as the
+ * byte at a time HDLC_scanBytes(). */
+
+#include "test.h"
+#include "HDLC_SCAN.h"
+
+static uint32_t testRandom = 1U;
+
+static uint8_t randomByte()
+{
+    testRandom = testRandom * 1103515245U + 12345U;
+    return (uint8_t)(testRandom >> 16U);
+}
+
+/* Mostly bytes outside the map, so that runs are long; some from the map. */
+static void randomData(uint8_t* data, uint16_t len, const uint8_t* map)
+{
+    for(uint16_t i = 0U; i < len; ++i)
+    {
+        do
+            data[i] = randomByte();
+        while(randomByte() % 32U != 0U && HDLC_escapeMapTest(map, data[i]));
+    }
+}
+
+typedef uint16_t (*Scan_t)(const uint8_t* data, uint16_t len,
+        const uint8_t* map);
+
+static uint16_t scanDispatch(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+    return HDLC_scan(data, len, map);
+}
+
+#if defined(HDLC_SCAN_SIMD)
+static uint16_t scanSSE2(const uint8_t* data, uint16_t len, const uint8_t*)
+{
+    return HDLC_scanSSE2(data, len);
+}
+
+static uint16_t scanAVX2(const uint8_t* data, uint16_t len, const uint8_t*)
+{
+    return HDLC_scanAVX2(data, len);
+}
+
+static uint16_t scanSSSE3Map(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+    return HDLC_scanSSSE3(data, len, map);
+}
+
+static uint16_t scanAVX2Map(const uint8_t* data, uint16_t len,
+        const uint8_t* map)
+{
+    return HDLC_scanAVX2(data, len, map);
+}
+#endif
+
+/* Compare scan with HDLC_scanBytes() at every buffer offset up to 32 and
+ * every length up to 100, with and without a map byte at the end. */
+static void testScan(Scan_t scan, const uint8_t* map)
+{
+    uint8_t buff[160U];
+    for(uint16_t round = 0U; round < 20U; ++round)
+    {
+        for(uint16_t offset = 0U; offset < 32U; ++offset)
+        {
+            for(uint16_t len = 0U; len <= 100U; ++len)
+            {
+                uint8_t* data = &buff[offset];
+                randomData(data, len, map);
+                if(len != 0U && round % 2U == 0U)
+                {
+                    /* Only the last byte is in the map, or none. */
+                    for(uint16_t i = 0U; i < len; ++i)
+                    {
+                        while(HDLC_escapeMapTest(map, data[i]))
+                            ++data[i];
+                    }
+                    if(round % 4U == 0U)
+                        data[len - 1U] = '~';
+                }
+                const uint16_t expect = HDLC_scanBytes(data, len, map);
+                const uint16_t found = scan(data, len, map);
+                CHECK(found == expect);
+                if(found != expect)
+                    return;
+            }
+        }
+    }
+}
+
+int main()
+{
+    /* ACCM of all control characters plus high bytes, whose row in the map
+     * is picked by the top bit; and random maps. */
+    uint8_t accm[HDLC_ESCAPEMAPLEN];
+    HDLC_escapeMapInit(accm, 0xFFFFFFFFUL);
+    HDLC_escapeMapAdd(accm, 0x80U);
+    HDLC_escapeMapAdd(accm, 0x91U);
+    HDLC_escapeMapAdd(accm, 0xB1U);
+    HDLC_escapeMapAdd(accm, 0xFFU);
+
+    uint8_t maps[8U][HDLC_ESCAPEMAPLEN];
+    for(uint8_t m = 0U; m < 8U; ++m)
+    {
+        HDLC_escapeMapInit(maps[m], 0U);
+        for(uint8_t i = 0U; i < 16U; ++i)
+            HDLC_escapeMapAdd(maps[m], randomByte());
+    }
+
+    testScan(scanDispatch, HDLC_ESCAPEMAP_DEFAULT);
+    testScan(scanDispatch, accm);
+
+#if defined(HDLC_SCAN_SIMD)
+    testScan(scanSSE2, HDLC_ESCAPEMAP_DEFAULT);
+    if(__builtin_cpu_supports("avx2"))
+        testScan(scanAVX2, HDLC_ESCAPEMAP_DEFAULT);
+    else
+        printf("test_scan: no AVX2, AVX2 search not tested\n");
+
+    if(__builtin_cpu_supports("ssse3"))
+    {
+        testScan(scanSSSE3Map, HDLC_ESCAPEMAP_DEFAULT);
+        testScan(scanSSSE3Map, accm);
+        for(uint8_t m = 0U; m < 8U; ++m)
+            testScan(scanSSSE3Map, maps[m]);
+    }
+    else
+    {
+        printf("test_scan: no SSSE3, SSSE3 search not tested\n");
+    }
+
+    if(__builtin_cpu_supports("avx2"))
+    {
+        testScan(scanAVX2Map, HDLC_ESCAPEMAP_DEFAULT);
+        testScan(scanAVX2Map, accm);
+        for(uint8_t m = 0U; m < 8U; ++m)
+            testScan(scanAVX2Map, maps[m]);
+    }
+#else
+    printf("test_scan: no vector search on this target\n");
+#endif
+
+    return testResult("test_scan");
+}
@@ -0,0 +1,185 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC_STATS: the counters and histograms after a known exchange. Built with
+ * HDLC_STATS=1. */
+
+#include "test.h"
+#include "HDLC_TL1B.h"
+#include "HDLC_TL3B_TOKEN.h"
+#include "CRC16_CCITT.h"
+
+#include <algorithm>
+
+#if !HDLC_STATS
+#error "test_stats needs HDLC_STATS=1"
+#endif
+
+typedef HDLC_PORT<8U, CRC16_CCITT> Link_t;
+typedef HDLC_TL1B_PORT<16U, CRC16_CCITT, 63U, 5U, 4U, false> GoBackN_t;
+typedef HDLC_TL3B_TOKEN_PORT<32U, CRC16_CCITT, 64U> Station_t;
+
+static void receiveAll(Link_t& link, TEST_WIRE& wire)
+{
+    while(!wire.empty())
+    {
+        link.receive();
+        link.releaseReceivedMessage();
+    }
+}
+
+static uint32_t sum(const uint32_t* bins, uint8_t len)
+{
+    uint32_t n = 0U;
+    for(uint8_t i = 0U; i < len; ++i)
+        n += bins[i];
+    return n;
+}
+
+/* Frame, byte, escape and error counters, and both histograms. */
+static void testLink()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Link_t a(wa.io());
+    Link_t b(wb.io());
+
+    a.transmitBlock("abc", 3U);
+    a.transmitBlock("~}~}", 4U);
+    a.transmitBlock("", 0U);
+    const uint32_t escapes = std::count(wa.out.begin(), wa.out.end(), '}');
+
+    HDLC_LINK_STATS s;
+    a.getStats(s);
+    CHECK(s.txFrames == 3U);
+    CHECK(s.txBytes == 7U);
+    CHECK(s.txEscaped == escapes);
+    CHECK(sum(s.txEscape, HDLC_STATS_ESCAPEBINS) == 3U);
+    /* 4 of 6 bytes escaped, CRC included, in the second frame. The CRCs of
+     * the others need no escape. */
+    CHECK(escapes == 4U);
+    CHECK(s.txEscape[0U] == 2U && s.txEscape[5U] == 1U);
+
+    /* The good frames, then a damaged one, an aborted one and one too long
+     * for the buffer. */
+    wb.in = wa.out;
+    TEST_FRAME bad(wa.out.begin(), wa.out.begin() + 7);
+    bad[2U] ^= 0x01U;
+    wb.in.insert(wb.in.end(), bad.begin(), bad.end());
+    const char abort[] = "~xy}~";
+    wb.in.insert(wb.in.end(), abort, abort + 5);
+    wb.in.insert(wb.in.end(), 20U, 'z');
+    wb.in.push_back('~');
+    receiveAll(b, wb);
+
+    b.getStats(s);
+    CHECK(s.rxFrames == 3U);
+    CHECK(s.rxBytes == 7U);
+    CHECK(s.rxEscaped == escapes + 1U);
+    CHECK(s.rxEmpty == 1U);
+    CHECK(s.rxCrcErrors == 1U);
+    CHECK(s.rxAborted == 1U);
+    CHECK(s.rxOversize == 1U);
+    CHECK(s.rxSize[0U] == 1U && s.rxSize[2U] == 1U && s.rxSize[3U] == 1U);
+    CHECK(sum(s.rxSize, HDLC_STATS_SIZEBINS) == 3U);
+    CHECK(s.txFrames == 0U);
+
+    b.resetStats();
+    b.getStats(s);
+    CHECK(s.rxFrames == 0U && s.rxBytes == 0U && s.rxCrcErrors == 0U);
+    CHECK(sum(s.rxSize, HDLC_STATS_SIZEBINS) == 0U);
+}
+
+/* ACKs, a NACK for a lost frame, the Go-Back-N retransmission and a
+ * timeout. */
+static void testTl1b()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    GoBackN_t a(wa.io());
+    GoBackN_t b(wb.io());
+    testNow = 0U;
+    a.setClock(testClock);
+    a.setRetransmitTimeout(100U, 10U, 1000U);
+
+    for(uint8_t n = 0U; n < 3U; ++n)
+        CHECK(a.transmitBlock("12345678", 8U));
+    std::vector<TEST_FRAME> frames = wa.frames();
+    wb.put(frames[0U]);
+    wb.put(frames[2U]);
+    while(!wb.empty())
+        b.receive();
+
+    HDLC_LINK_STATS s;
+    b.getStats(s);
+    CHECK(s.acksSent == 1U);
+    CHECK(s.nacksSent == 1U);
+    CHECK(s.rxCrcErrors == 0U);
+
+    frames = wb.frames();
+    for(size_t i = 0U; i < frames.size(); ++i)
+        wa.put(frames[i]);
+    while(!wa.empty())
+        a.receive();
+    a.getStats(s);
+    CHECK(s.nacksReceived == 1U);
+    CHECK(s.retransmits == 2U);
+    CHECK(s.timeouts == 0U);
+
+    /* Both timers expire: one timeout each, one window sent again. */
+    testNow = 100U;
+    a.poll();
+    a.getStats(s);
+    CHECK(s.timeouts == 2U);
+    CHECK(s.retransmits == 4U);
+    CHECK(s.txFrames == 7U);
+    CHECK(s.resets == 0U);
+}
+
+/* A token pass, its retries and the skip of the missing station. */
+static void testTl3b()
+{
+    TEST_WIRE wire;
+    const uint8_t ring[3U] = { 1U, 2U, 3U };
+    Station_t station(wire.io(), 1U, true);
+    testNow = 0U;
+    station.setRing(ring, 3U);
+    station.setClock(testClock);
+    station.setTokenTimeout(10U, 1000U);
+
+    station.poll();
+    for(uint8_t n = 1U; n <= 4U; ++n)
+    {
+        testNow = 10U * n;
+        station.poll();
+    }
+
+    HDLC_LINK_STATS s;
+    station.getStats(s);
+    CHECK(s.tokenPasses == 2U);
+    CHECK(s.tokenRetries == 3U);
+    CHECK(s.tokenSkips == 1U);
+    CHECK(s.tokenRegenerations == 0U);
+    CHECK(s.txFrames == 5U);
+}
+
+int main()
+{
+    testLink();
+    testTl1b();
+    testTl3b();
+    return testResult("test_stats");
+}
@@ -0,0 +1,448 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC_TL1B window mode: Go-Back-N and selective repeat under loss,
+ * reordering and timeouts. */
+
+#include "test.h"
+#include "HDLC_TL1B.h"
+#include "CRC16_CCITT.h"
+
+typedef HDLC_TL1B_PORT<16U, CRC16_CCITT, 63U, 5U, 4U, false> GoBackN_t;
+typedef HDLC_TL1B_PORT<16U, CRC16_CCITT, 63U, 5U, 4U, true> Selective_t;
+typedef HDLC_TL1B_PORT<16U, CRC16_CCITT> Legacy_t;
+
+/* Move the frames written on one wire to the input of the other. Frame i is
+ * dropped if bit i of drop is set. Returns the number of frames. */
+static size_t transfer(TEST_WIRE& from, TEST_WIRE& to, uint32_t drop = 0U)
+{
+    const std::vector<TEST_FRAME> frames = from.frames();
+    for(size_t i = 0U; i < frames.size(); ++i)
+    {
+        if(i >= 32U || ((drop >> i) & 1U) == 0U)
+            to.put(frames[i]);
+    }
+    return frames.size();
+}
+
+/* Move the frames like transfer(), with frames i and j swapped. */
+static size_t reorder(TEST_WIRE& from, TEST_WIRE& to, size_t i, size_t j)
+{
+    std::vector<TEST_FRAME> frames = from.frames();
+    if(i < frames.size() && j < frames.size())
+        frames[i].swap(frames[j]);
+    for(size_t n = 0U; n < frames.size(); ++n)
+        to.put(frames[n]);
+    return frames.size();
+}
+
+/* Receive everything waiting on the wire. Returns the delivered messages. */
+template<class Link_t>
+static std::vector<TEST_FRAME> drain(Link_t& link, TEST_WIRE& wire)
+{
+    std::vector<TEST_FRAME> msgs;
+    for(;;)
+    {
+        const uint16_t len = link.receive();
+        if(len != 0U)
+        {
+            const uint8_t* msg;
+            link.getReceivedMessage(msg);
+            msgs.push_back(TEST_FRAME(msg, msg + len));
+            link.releaseReceivedMessage();
+        }
+        else if(wire.empty())
+        {
+            break;
+        }
+    }
+    return msgs;
+}
+
+static TEST_FRAME message(uint8_t n, uint16_t len = 8U)
+{
+    return TEST_FRAME(len, n);
+}
+
+/* Exchange frames without loss until both sides are quiet. Returns the
+ * messages delivered to b, after the ones in msgs. */
+template<class Link_t>
+static std::vector<TEST_FRAME> settle(Link_t& a, TEST_WIRE& wa, Link_t& b,
+        TEST_WIRE& wb, std::vector<TEST_FRAME> msgs)
+{
+    for(int round = 0; round < 16 && !(wa.out.empty() && wb.out.empty()); ++round)
+    {
+        transfer(wa, wb);
+        const std::vector<TEST_FRAME> got = drain(b, wb);
+        msgs.insert(msgs.end(), got.begin(), got.end());
+        transfer(wb, wa);
+        drain(a, wa);
+    }
+    return msgs;
+}
+
+/* The messages 0 to n - 1, each once and in order. */
+static bool inOrder(const std::vector<TEST_FRAME>& msgs, uint8_t n)
+{
+    if(msgs.size() != n)
+        return false;
+    for(uint8_t i = 0U; i < n; ++i)
+    {
+        if(msgs[i] != message(i))
+            return false;
+    }
+    return true;
+}
+
+/* A message longer than the retransmit slot is refused, or aborted if it is
+ * written a piece at a time. The sequence numbers stay in step. */
+static void testOversize()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    GoBackN_t a(wa.io());
+    GoBackN_t b(wb.io());
+
+    const TEST_FRAME big = message(1U, 17U);
+    CHECK(!a.transmitBlock(big.data(), big.size()));
+    CHECK(wa.out.empty());
+    CHECK(a.getTransmitPending() == 0U);
+
+    const HDLC_SEGMENT seg[2U] = { { big.data(), 10U }, { big.data(), 7U } };
+    CHECK(!a.transmitGather(seg, 2U));
+    CHECK(wa.out.empty());
+
+    a.transmitStart();
+    a.transmitBytes(big.data(), 10U);
+    a.transmitBytes(big.data(), 7U);
+    a.transmitByte(0U);
+    CHECK(!a.transmitEnd());
+    CHECK(a.getTransmitPending() == 0U);
+
+    const TEST_FRAME full = message(2U, 16U);
+    CHECK(a.transmitBlock(full.data(), full.size()));
+    CHECK(a.getTransmitPending() == 1U);
+
+    transfer(wa, wb);
+    const std::vector<TEST_FRAME> msgs = drain(b, wb);
+    CHECK(msgs.size() == 1U && msgs[0U] == full);
+
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 0U);
+}
+
+/* A full window refuses new frames without resetting the link. */
+static void testWindowFull()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    GoBackN_t a(wa.io());
+    GoBackN_t b(wb.io());
+
+    for(uint8_t n = 0U; n < 4U; ++n)
+        CHECK(a.transmitBlock(message(n).data(), 8U));
+    CHECK(!a.transmitReady());
+    CHECK(transfer(wa, wb) == 4U);
+
+    CHECK(!a.transmitBlock(message(4U).data(), 8U));
+    CHECK(!a.transmitStart());
+    a.transmitByte(0U);
+    CHECK(!a.transmitEnd());
+    CHECK(wa.out.empty());
+    CHECK(a.getTransmitPending() == 4U);
+
+    CHECK(drain(b, wb).size() == 4U);
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 0U);
+
+    CHECK(a.transmitBlock(message(4U).data(), 8U));
+    transfer(wa, wb);
+    const std::vector<TEST_FRAME> msgs = drain(b, wb);
+    CHECK(msgs.size() == 1U && msgs[0U] == message(4U));
+}
+
+/* window = 0 acknowledges every frame and keeps no window state. */
+static void testLegacy()
+{
+    CHECK(sizeof(Legacy_t) <= sizeof(HDLC_PORT<17U, CRC16_CCITT>) + sizeof(void*));
+
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Legacy_t a(wa.io());
+    Legacy_t b(wb.io());
+    a.setClock(testClock);
+
+    for(uint8_t n = 0U; n < 8U; ++n)
+    {
+        CHECK(a.transmitReady());
+        CHECK(a.transmitBlock(message(n).data(), 8U));
+        CHECK(transfer(wa, wb) == 1U);
+        const std::vector<TEST_FRAME> msgs = drain(b, wb);
+        CHECK(msgs.size() == 1U && msgs[0U] == message(n));
+        CHECK(transfer(wb, wa) == 1U);
+        CHECK(drain(a, wa).empty());
+    }
+    CHECK(a.getTransmitPending() == 0U);
+
+    /* Without ACKs the link is reset after noAckLim frames. */
+    for(uint8_t n = 0U; n < 5U; ++n)
+        a.transmitBlock(message(n).data(), 8U);
+    CHECK(transfer(wa, wb) == 6U);
+}
+
+/* A lost frame is asked for with a NACK. Go-Back-N sends it and every frame
+ * after it again, selective repeat only the lost one. */
+template<class Link_t>
+static void testLoss(bool selective)
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Link_t a(wa.io());
+    Link_t b(wb.io());
+
+    for(uint8_t n = 0U; n < 4U; ++n)
+        CHECK(a.transmitBlock(message(n).data(), 8U));
+    CHECK(transfer(wa, wb, 1U << 1U) == 4U);
+
+    /* Frame 0 is delivered. Frames 2 and 3 are kept by selective repeat,
+     * dropped by Go-Back-N. */
+    std::vector<TEST_FRAME> msgs = drain(b, wb);
+    CHECK(inOrder(msgs, 1U));
+
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 3U);
+    CHECK(transfer(wa, wb) == (selective ? 1U : 3U));
+
+    const std::vector<TEST_FRAME> got = drain(b, wb);
+    msgs.insert(msgs.end(), got.begin(), got.end());
+    CHECK(inOrder(msgs, 4U));
+
+    settle(a, wa, b, wb, msgs);
+    CHECK(a.getTransmitPending() == 0U);
+}
+
+/* Frames that arrive out of order are delivered once each and in order. */
+template<class Link_t>
+static void testReorder()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Link_t a(wa.io());
+    Link_t b(wb.io());
+
+    for(uint8_t n = 0U; n < 4U; ++n)
+        CHECK(a.transmitBlock(message(n).data(), 8U));
+    CHECK(reorder(wa, wb, 1U, 2U) == 4U);
+
+    const std::vector<TEST_FRAME> msgs = settle(a, wa, b, wb, drain(b, wb));
+    CHECK(inOrder(msgs, 4U));
+    CHECK(a.getTransmitPending() == 0U);
+}
+
+/* Without any answer only retransmit() sends again: Go-Back-N the whole
+ * window, selective repeat the oldest frame. */
+template<class Link_t>
+static void testRetransmit(bool selective)
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Link_t a(wa.io());
+    Link_t b(wb.io());
+
+    for(uint8_t n = 0U; n < 3U; ++n)
+        CHECK(a.transmitBlock(message(n).data(), 8U));
+    CHECK(transfer(wa, wb, 7U) == 3U);
+    CHECK(drain(b, wb).empty());
+    CHECK(wb.out.empty());
+
+    a.retransmit();
+    CHECK(transfer(wa, wb) == (selective ? 1U : 3U));
+
+    const std::vector<TEST_FRAME> msgs = settle(a, wa, b, wb, drain(b, wb));
+    CHECK(inOrder(msgs, selective ? 1U : 3U));
+    CHECK(a.getTransmitPending() == (selective ? 2U : 0U));
+}
+
+/* The retransmission timeout follows the round trip time (SRTT + 4 RTTVAR),
+ * doubles on every expiry and takes no sample from a retransmitted frame
+ * (Karn). */
+static void testRto()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    GoBackN_t a(wa.io());
+    GoBackN_t b(wb.io());
+    testNow = 0U;
+    a.setClock(testClock);
+    a.setRetransmitTimeout(1000U, 10U, 60000U);
+    CHECK(a.getRto() == 1000U);
+
+    /* Nothing is sent again before the initial timeout. */
+    CHECK(a.transmitBlock(message(0U).data(), 8U));
+    CHECK(transfer(wa, wb) == 1U);
+    testNow = 999U;
+    a.poll();
+    CHECK(wa.out.empty());
+    testNow = 1000U;
+    a.poll();
+    CHECK(transfer(wa, wb) == 1U);
+    CHECK(a.getRto() == 2000U);
+
+    /* The ACK of a retransmitted frame gives no sample. */
+    CHECK(drain(b, wb).size() == 1U);
+    testNow = 1040U;
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 0U);
+    CHECK(a.getRtt() == 0U);
+    CHECK(a.getRto() == 2000U);
+
+    /* First sample: SRTT = 40, RTTVAR = 20. */
+    CHECK(a.transmitBlock(message(1U).data(), 8U));
+    transfer(wa, wb);
+    drain(b, wb);
+    testNow += 40U;
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getRtt() == 40U);
+    CHECK(a.getRto() == 120U);
+
+    /* Lost: the timer expires after the RTO and doubles it. */
+    CHECK(a.transmitBlock(message(2U).data(), 8U));
+    CHECK(transfer(wa, wb, 1U) == 1U);
+    testNow += 119U;
+    a.poll();
+    CHECK(wa.out.empty());
+    testNow += 1U;
+    a.poll();
+    CHECK(a.getRto() == 240U);
+    testNow += 240U;
+    a.poll();
+    CHECK(a.getRto() == 480U);
+    CHECK(transfer(wa, wb) == 2U);
+
+    /* Karn: the late ACK of the retransmitted frame keeps the backed off
+     * timeout and the old round trip time. */
+    CHECK(drain(b, wb).size() == 1U);
+    testNow += 300U;
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 0U);
+    CHECK(a.getRtt() == 40U);
+    CHECK(a.getRto() == 480U);
+
+    /* A new frame timed at 40 again: RTTVAR = 15, RTO = 40 + 60. */
+    CHECK(a.transmitBlock(message(3U).data(), 8U));
+    transfer(wa, wb);
+    drain(b, wb);
+    testNow += 40U;
+    transfer(wb, wa);
+    drain(a, wa);
+    CHECK(a.getRtt() == 40U);
+    CHECK(a.getRto() == 100U);
+}
+
+/* Kind of a frame on the wire, from its first byte. */
+static uint8_t frameKind(const TEST_FRAME& frame)
+{
+    return frame.empty() ? 0xFFU : (frame[0U] & 0xC0U);
+}
+
+/* Move the frames like transfer(). True if there was exactly one, of the
+ * given kind. */
+static bool transferOne(TEST_WIRE& from, TEST_WIRE& to, uint8_t kind)
+{
+    const std::vector<TEST_FRAME> frames = from.frames();
+    for(size_t i = 0U; i < frames.size(); ++i)
+        to.put(frames[i]);
+    return frames.size() == 1U && frameKind(frames[0U]) == kind;
+}
+
+/* A delayed ACK is sent after frames frames or ticks ticks, whichever comes
+ * first, from receive() or poll(). Outgoing DATA carries it instead. */
+static void testAckDelay()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    GoBackN_t a(wa.io());
+    GoBackN_t b(wb.io());
+    testNow = 0U;
+    b.setClock(testClock);
+    b.setAckDelay(3U, 100U);
+
+    /* No ACK before the third frame. */
+    for(uint8_t n = 0U; n < 2U; ++n)
+        CHECK(a.transmitBlock(message(n).data(), 8U));
+    transfer(wa, wb);
+    CHECK(drain(b, wb).size() == 2U);
+    CHECK(wb.out.empty());
+    CHECK(a.transmitBlock(message(2U).data(), 8U));
+    transfer(wa, wb);
+    CHECK(drain(b, wb).size() == 1U);
+    CHECK(transferOne(wb, wa, 0x40U));
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 0U);
+
+    /* No ACK before ticks; then poll() sends it. */
+    testNow = 1000U;
+    CHECK(a.transmitBlock(message(3U).data(), 8U));
+    transfer(wa, wb);
+    CHECK(drain(b, wb).size() == 1U);
+    testNow = 1099U;
+    b.poll();
+    CHECK(wb.out.empty());
+    testNow = 1100U;
+    b.poll();
+    CHECK(transferOne(wb, wa, 0x40U));
+    drain(a, wa);
+    CHECK(a.getTransmitPending() == 0U);
+
+    /* The ACK rides on a DATA frame and clears the window of a. No separate
+     * ACK follows. */
+    testNow = 2000U;
+    CHECK(a.transmitBlock(message(4U).data(), 8U));
+    CHECK(a.getTransmitPending() == 1U);
+    transfer(wa, wb);
+    CHECK(drain(b, wb).size() == 1U);
+    CHECK(wb.out.empty());
+    CHECK(b.transmitBlock(message(9U).data(), 8U));
+    CHECK(transferOne(wb, wa, 0xC0U));
+    const std::vector<TEST_FRAME> msgs = drain(a, wa);
+    CHECK(msgs.size() == 1U && msgs[0U] == message(9U));
+    CHECK(a.getTransmitPending() == 0U);
+    testNow = 2200U;
+    b.poll();
+    CHECK(wb.out.empty());
+}
+
+int main()
+{
+    testOversize();
+    testWindowFull();
+    testLegacy();
+    testLoss<GoBackN_t>(false);
+    testLoss<Selective_t>(true);
+    testReorder<GoBackN_t>();
+    testReorder<Selective_t>();
+    testRetransmit<GoBackN_t>(false);
+    testRetransmit<Selective_t>(true);
+    testRto();
+    testAckDelay();
+    return testResult("test_tl1b");
+}
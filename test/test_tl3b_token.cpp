@@ -0,0 +1,312 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC_TL3B_TOKEN: token scheduler and token recovery. */
+
+#include "test.h"
+#include "HDLC_TL3B_TOKEN.h"
+#include "CRC16_CCITT.h"
+
+typedef HDLC_TL3B_TOKEN_PORT<32U, CRC16_CCITT, 64U> Station_t;
+
+/* Without a ring the token stays here and nothing is sent. */
+static void testNoRing()
+{
+    TEST_WIRE wire;
+    Station_t station(wire.io(), 1U, true);
+
+    CHECK(station.getNextStation() == 1U);
+    station.poll();
+    CHECK(station.haveToken());
+    CHECK(wire.out.empty());
+
+    const uint8_t ring[1U] = { 2U };
+    station.setRing(ring, 0U);
+    CHECK(station.getNextStation() == 1U);
+    station.poll();
+    CHECK(station.haveToken());
+    CHECK(wire.out.empty());
+}
+
+/* Receive a WRITE frame from station 9 to address to, a byte at a time.
+ * Returns the delivered length. */
+static uint16_t receiveWrite(Station_t& station, TEST_WIRE& wire, uint8_t to)
+{
+    Station_t sender(wire.io(), 9U);
+    uint8_t frame[Station_t::encodedSizeMax(4U)];
+    const uint32_t len = sender.encodeWrite(to, "abcd", 4U, frame, sizeof(frame));
+    wire.in.insert(wire.in.end(), frame, frame + len);
+
+    uint16_t datalen = 0U;
+    while(!wire.empty() && datalen == 0U)
+        datalen = station.receive();
+    return datalen;
+}
+
+/* A copy filters frames with its own address, also when the original is
+ * gone. */
+static void testCopy()
+{
+    TEST_WIRE wire;
+    Station_t original(wire.io(), 3U);
+    Station_t copy(original);
+    copy.setAddress(8U);
+    CHECK(receiveWrite(copy, wire, 8U) == 4U);
+    CHECK(copy.getRxFilteredCount() == 0U);
+
+    std::vector<Station_t> stations;
+    for(uint8_t i = 1U; i <= 8U; ++i)
+        stations.push_back(Station_t(wire.io(), i));
+    CHECK(receiveWrite(stations.back(), wire, 8U) == 4U);
+    CHECK(receiveWrite(stations.front(), wire, 1U) == 4U);
+}
+
+/* Frames for other stations are CRC checked and counted as received, unless
+ * setSkipOthers() skips them unchecked without token recovery. */
+static void testRxCount()
+{
+    TEST_WIRE wire;
+    Station_t station(wire.io(), 1U);
+
+    /* Noise with a plausible header and a bad CRC. */
+    const uint8_t noise[] = { '~', Station_t::CMD_WRITE, 5U, 6U, 1U, 2U, 3U, '~' };
+
+    CHECK(receiveWrite(station, wire, 2U) == 0U);
+    CHECK(station.getRxCount() == 1U);
+    CHECK(station.getRxFilteredCount() == 1U);
+    wire.in.insert(wire.in.end(), noise, noise + sizeof(noise));
+    while(!wire.empty())
+        station.receive();
+    CHECK(station.getRxCount() == 1U);
+    CHECK(station.getRxFilteredCount() == 1U);
+
+    station.setSkipOthers(true);
+    CHECK(receiveWrite(station, wire, 2U) == 0U);
+    CHECK(station.getRxCount() == 1U);
+    CHECK(station.getRxFilteredCount() == 2U);
+    wire.in.insert(wire.in.end(), noise, noise + sizeof(noise));
+    while(!wire.empty())
+        station.receive();
+    CHECK(station.getRxCount() == 1U);
+    CHECK(station.getRxFilteredCount() == 3U);
+
+    /* With token recovery the CRC is checked and the frame counts. */
+    station.setTokenTimeout(100U, 1000U);
+    CHECK(receiveWrite(station, wire, 2U) == 0U);
+    CHECK(station.getRxCount() == 2U);
+    wire.in.insert(wire.in.end(), noise, noise + sizeof(noise));
+    while(!wire.empty())
+        station.receive();
+    CHECK(station.getRxCount() == 2U);
+
+    CHECK(receiveWrite(station, wire, 1U) == 4U);
+    CHECK(station.getRxCount() == 3U);
+}
+
+/* Only token recovery takes a frame from the new holder as its ACK_TOKEN. */
+static void testImplicitAck()
+{
+    const uint8_t ring[2U] = { 1U, 2U };
+
+    for(int recovery = 0; recovery < 2; ++recovery)
+    {
+        TEST_WIRE wire;
+        Station_t station(wire.io(), 1U, true);
+        station.setRing(ring, 2U);
+        if(recovery)
+        {
+            station.setClock(testClock);
+            station.setTokenTimeout(100U, 1000U);
+        }
+        station.poll();
+        CHECK(station.getTokenState() == Station_t::TOKEN_PASSING);
+
+        Station_t holder(wire.io(), 2U);
+        uint8_t frame[Station_t::encodedSizeMax(4U)];
+        const uint32_t len = holder.encodeWrite(3U, "abcd", 4U, frame, sizeof(frame));
+        wire.in.insert(wire.in.end(), frame, frame + len);
+        while(!wire.empty())
+            station.receive();
+
+        CHECK(station.getTokenState() == (recovery ?
+                Station_t::TOKEN_DONT_HAVE : Station_t::TOKEN_PASSING));
+    }
+}
+
+/* A GIVE_TOKEN without answer is sent again every passTicks. After
+ * TOKEN_RETRIES retries the station after it in the ring gets the token. */
+static void testTokenRetry()
+{
+    const uint8_t ring[3U] = { 1U, 2U, 3U };
+    TEST_WIRE wire;
+    Station_t station(wire.io(), 1U, true);
+    station.setRing(ring, 3U);
+    testNow = 0U;
+    station.setClock(testClock);
+    station.setTokenTimeout(10U, 100U);
+
+    station.poll();
+    std::vector<TEST_FRAME> frames = wire.frames();
+    CHECK(frames.size() == 1U);
+    CHECK(frames[0U][0U] == Station_t::CMD_GIVE_TOKEN && frames[0U][2U] == 2U);
+
+    for(uint8_t retry = 0U; retry < 3U; ++retry)
+    {
+        testNow += 9U;
+        station.poll();
+        CHECK(wire.out.empty());
+        testNow += 1U;
+        station.poll();
+        frames = wire.frames();
+        CHECK(frames.size() == 1U);
+        CHECK(frames[0U][0U] == Station_t::CMD_GIVE_TOKEN && frames[0U][2U] == 2U);
+        CHECK(station.getTokenState() == Station_t::TOKEN_PASSING);
+    }
+
+    testNow += 10U;
+    station.poll();
+    frames = wire.frames();
+    CHECK(frames.size() == 1U);
+    CHECK(frames[0U][0U] == Station_t::CMD_GIVE_TOKEN && frames[0U][2U] == 3U);
+    CHECK(station.getTokenAddress() == 3U);
+}
+
+/* Stations sharing one bus. What one sends, the others that are present
+ * receive one tick later. A station that sends GIVE_TOKEN or RESET holds the
+ * token; most is the most stations doing that in one tick. */
+struct TEST_BUS {
+    TEST_WIRE wire[3U];
+    Station_t* station[3U];
+    bool present[3U];
+    bool held[3U];
+    int first;
+    unsigned most;
+
+    TEST_BUS(bool master): first(-1), most(0U) {
+        static const uint8_t ring[3U] = { 1U, 2U, 3U };
+        for(uint8_t i = 0U; i < 3U; ++i)
+        {
+            station[i] = new Station_t(wire[i].io(), i + 1U, master && i == 0U);
+            station[i]->setRing(ring, 3U);
+            station[i]->setClock(testClock);
+            station[i]->setTokenTimeout(10U, 100U);
+            present[i] = true;
+            held[i] = false;
+        }
+    }
+
+    ~TEST_BUS() {
+        for(uint8_t i = 0U; i < 3U; ++i)
+            delete station[i];
+    }
+
+    /* Poll the present stations once a tick and pass on what they sent. */
+    void run(uint32_t ticks) {
+        for(uint32_t t = 0U; t < ticks; ++t)
+        {
+            ++testNow;
+            for(uint8_t i = 0U; i < 3U; ++i)
+            {
+                if(present[i])
+                    station[i]->poll();
+            }
+
+            unsigned holders = 0U;
+            for(uint8_t i = 0U; i < 3U; ++i)
+            {
+                const std::vector<TEST_FRAME> frames = wire[i].frames();
+                bool holder = false;
+                for(size_t f = 0U; f < frames.size() && present[i]; ++f)
+                {
+                    if(frames[f][0U] == Station_t::CMD_GIVE_TOKEN ||
+                            frames[f][0U] == Station_t::CMD_RESET)
+                        holder = true;
+                    for(uint8_t j = 0U; j < 3U; ++j)
+                    {
+                        if(j != i && present[j])
+                            wire[j].put(frames[f]);
+                    }
+                }
+                if(holder)
+                {
+                    ++holders;
+                    held[i] = true;
+                    if(first < 0)
+                        first = i;
+                }
+            }
+            if(holders > most)
+                most = holders;
+
+            for(uint8_t j = 0U; j < 3U; ++j)
+            {
+                while(!wire[j].empty())
+                    station[j]->receive();
+            }
+        }
+    }
+};
+
+/* A station that is gone is skipped after its retries, and the token keeps
+ * going round the others. */
+static void testTokenSkip()
+{
+    testNow = 0U;
+    TEST_BUS bus(true);
+    bus.present[1U] = false;
+
+    bus.run(200U);
+    CHECK(bus.most == 1U);
+    CHECK(bus.held[0U] && bus.held[2U]);
+    CHECK(!bus.held[1U]);
+}
+
+/* On a silent bus the station of lowest rank takes the token; the others
+ * see its RESET and do not. */
+static void testTokenRegeneration()
+{
+    testNow = 0U;
+    TEST_BUS bus(false);
+    bus.run(99U);
+    CHECK(bus.first < 0);
+    bus.run(200U);
+    CHECK(bus.first == 0);
+    CHECK(bus.most == 1U);
+    CHECK(bus.held[0U] && bus.held[1U] && bus.held[2U]);
+
+    /* Without station 1, station 2 is next by rank. */
+    testNow = 0U;
+    TEST_BUS rest(false);
+    rest.present[0U] = false;
+    rest.run(109U);
+    CHECK(rest.first < 0);
+    rest.run(200U);
+    CHECK(rest.first == 1);
+    CHECK(rest.most == 1U);
+    CHECK(rest.held[2U]);
+}
+
+int main()
+{
+    testNoRing();
+    testCopy();
+    testRxCount();
+    testImplicitAck();
+    testTokenRetry();
+    testTokenSkip();
+    testTokenRegeneration();
+    return testResult("test_tl3b_token");
+}
@@ -0,0 +1,186 @@
+/*
+ Copyright 2016 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/* HDLC_TRACE: the events of a frame and its ACK, the full ring and the Chrome
+ * trace export. Built with HDLC_TRACE=1 and a ring of HDLC_TRACE_LEN = 64. */
+
+#include "test.h"
+#include "HDLC_TL1B.h"
+#include "CRC16_CCITT.h"
+
+#include <string>
+
+#if !HDLC_TRACE
+#error "test_trace needs HDLC_TRACE=1"
+#endif
+
+typedef HDLC_TL1B_PORT<16U, CRC16_CCITT> Link_t;
+
+struct EXPECT {
+    const void* link;
+    uint32_t time;
+    uint8_t event;
+    uint16_t arg;
+};
+
+/* The ring holds exactly the expected events, in order. */
+static void checkEvents(const EXPECT* expect, size_t count)
+{
+    HDLC_TRACE_RECORD r;
+    for(size_t i = 0U; i < count; ++i)
+    {
+        CHECK(HDLC_traceRead(r));
+        CHECK(r.link == expect[i].link);
+        CHECK(r.time == expect[i].time);
+        CHECK(r.event == expect[i].event);
+        CHECK(r.arg == expect[i].arg);
+    }
+    CHECK(!HDLC_traceRead(r));
+}
+
+/* Send one frame from a to b at time 10. b receives its first two bytes at
+ * time 11 and the rest at 13, and a the ACK at 20. */
+static void exchange(Link_t& a, TEST_WIRE& wa, Link_t& b, TEST_WIRE& wb)
+{
+    testNow = 10U;
+    CHECK(a.transmitBlock("abc", 3U));
+    wb.in.swap(wa.out);
+    wb.inPos = 0U;
+    testNow = 11U;
+    while(!wb.empty())
+    {
+        if(wb.inPos == 2U)
+            testNow = 13U;
+        if(b.receive() != 0U)
+            b.releaseReceivedMessage();
+    }
+
+    testNow = 20U;
+    wa.in.swap(wb.out);
+    wa.inPos = 0U;
+    while(!wa.empty())
+        a.receive();
+}
+
+static void testEvents()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Link_t a(wa.io());
+    Link_t b(wb.io());
+    exchange(a, wa, b, wb);
+
+    /* DATA | 0, "abc" and the CRC; ACK | 0 and the CRC. */
+    const EXPECT expect[] = {
+        { &a, 10U, HDLC_TRACE_TX_START, 0U },
+        { &a, 10U, HDLC_TRACE_TX_END, 0U },
+        { &b, 11U, HDLC_TRACE_RX_START, 0U },
+        { &b, 13U, HDLC_TRACE_RX_END, 6U },
+        { &b, 13U, HDLC_TRACE_RX_GOOD, 4U },
+        { &b, 13U, HDLC_TRACE_ACK_TX, 0U },
+        { &b, 13U, HDLC_TRACE_TX_START, 0U },
+        { &b, 13U, HDLC_TRACE_TX_END, 0U },
+        { &b, 13U, HDLC_TRACE_DELIVER, 3U },
+        { &a, 20U, HDLC_TRACE_RX_START, 0U },
+        { &a, 20U, HDLC_TRACE_RX_END, 3U },
+        { &a, 20U, HDLC_TRACE_RX_GOOD, 1U },
+        { &a, 20U, HDLC_TRACE_ACK_RX, 0U }
+    };
+    checkEvents(expect, sizeof(expect) / sizeof(expect[0U]));
+    CHECK(HDLC_traceDropped() == 0U);
+}
+
+/* A full ring drops new events and counts them; it is usable again once
+ * read. */
+static void testFull()
+{
+    int link;
+    for(uint16_t i = 0U; i < HDLC_TRACE_LEN + 5U; ++i)
+        HDLC_traceWrite(&link, HDLC_TRACE_DELIVER, i);
+    CHECK(HDLC_traceDropped() == 5U);
+
+    HDLC_TRACE_RECORD r;
+    for(uint16_t i = 0U; i < HDLC_TRACE_LEN; ++i)
+    {
+        CHECK(HDLC_traceRead(r));
+        CHECK(r.arg == i);
+    }
+    CHECK(!HDLC_traceRead(r));
+
+    HDLC_traceWrite(&link, HDLC_TRACE_DELIVER, 7U);
+    CHECK(HDLC_traceRead(r) && r.arg == 7U);
+}
+
+/* Frames become slices, the other events instants, one thread per link. */
+static void testExport()
+{
+    TEST_WIRE wa;
+    TEST_WIRE wb;
+    Link_t a(wa.io());
+    Link_t b(wb.io());
+    exchange(a, wa, b, wb);
+
+    const char* path = "test_trace.json";
+    CHECK(HDLC_traceExportChrome(path, 2.0));
+    HDLC_TRACE_RECORD r;
+    CHECK(!HDLC_traceRead(r));
+
+    std::string json;
+    FILE* f = fopen(path, "r");
+    CHECK(f != 0);
+    if(f == 0)
+        return;
+    char buff[256];
+    size_t n;
+    while((n = fread(buff, 1U, sizeof(buff), f)) != 0U)
+        json.append(buff, n);
+    fclose(f);
+    remove(path);
+
+    const std::string expect =
+        "{\"traceEvents\":["
+        "\n{\"name\":\"tx-frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,"
+        "\"ts\":5.000,\"dur\":0.000,\"args\":{\"len\":0}},"
+        "\n{\"name\":\"rx-frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+        "\"ts\":5.500,\"dur\":1.000,\"args\":{\"len\":6}},"
+        "\n{\"name\":\"rx-good\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+        "\"tid\":1,\"ts\":6.500,\"args\":{\"arg\":4}},"
+        "\n{\"name\":\"ack-tx\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+        "\"tid\":1,\"ts\":6.500,\"args\":{\"arg\":0}},"
+        "\n{\"name\":\"tx-frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+        "\"ts\":6.500,\"dur\":0.000,\"args\":{\"len\":0}},"
+        "\n{\"name\":\"deliver\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+        "\"tid\":1,\"ts\":6.500,\"args\":{\"arg\":3}},"
+        "\n{\"name\":\"rx-frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,"
+        "\"ts\":10.000,\"dur\":0.000,\"args\":{\"len\":3}},"
+        "\n{\"name\":\"rx-good\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+        "\"tid\":0,\"ts\":10.000,\"args\":{\"arg\":1}},"
+        "\n{\"name\":\"ack-rx\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+        "\"tid\":0,\"ts\":10.000,\"args\":{\"arg\":0}}"
+        "\n],\"otherData\":{\"dropped\":5}}\n";
+    CHECK(json == expect);
+    if(json != expect)
+        fprintf(stderr, "%s", json.c_str());
+}
+
+int main()
+{
+    HDLC_traceSetClock(testClock);
+    testEvents();
+    testFull();
+    testExport();
+    return testResult("test_trace");
+}